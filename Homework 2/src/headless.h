@@ -0,0 +1,284 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "gl_resources.h"
+
+// Default headless options
+const unsigned int HEADLESS_FRAMES        = 300; // frames measured before the application quits
+const unsigned int HEADLESS_WARMUP_FRAMES = 30;  // frames rendered before measuring starts
+const unsigned int HEADLESS_QUERY_FRAMES  = 4;   // frames of GPU timestamps in flight
+
+// Command line options of the headless mode:
+//   --headless       render offscreen, no display needed
+//   --size WxH       size of the offscreen framebuffer, the window size by default
+//   --warmup N       frames rendered before measuring, e.g. to fill caches
+//   --frames N       frames measured before quitting
+//   --bench FILE     writes the frame time statistics to FILE as JSON
+struct HeadlessOptions {
+	bool Enabled;
+	unsigned int Width, Height;
+	unsigned int Warmup, Frames;
+	std::string Bench;
+};
+
+// Frame times of the measured frames in milliseconds
+struct FrameTimeStats {
+	unsigned int Samples;
+	double Mean, P50, P99, Max;
+};
+
+// Runs a demo without a display, e.g. on benchmark machines.
+//
+// GLFW (3.4 or later) is initialized with its null platform, which has no
+// windows or input, and the context is created through EGL or, if that
+// fails, OSMesa; both work on a software renderer like llvmpipe. The scene is
+// drawn into a framebuffer object that replaces the default framebuffer, and
+// the application closes itself after the configured number of frames.
+// Without --headless every call leaves the application unchanged.
+//
+// After the warmup, the CPU time between the ends of consecutive frames (from
+// beginFrame() for the first one) and the GPU time between timestamps taken
+// at beginFrame() and endFrame() are kept for every frame, so both cover the
+// same frames. Timestamps are read back a few frames late, so the measurement
+// does not stall the pipeline, and do not interfere with GL_TIME_ELAPSED
+// queries of a profiler.
+class Headless {
+public:
+	HeadlessOptions Options;
+	std::vector<std::string> Arguments; // command line without the headless options
+	unsigned int FBO, ColorRBO, DepthRBO;
+	// the same objects in the GLResources pool
+	FramebufferHandle Framebuffer;
+	RenderbufferHandle ColorBuffer, DepthBuffer;
+	// of the measured frames
+	std::vector<double> CpuTimes, GpuTimes;
+
+	Headless(int argc, char* argv[], unsigned int width, unsigned int height) : FBO(0), ColorRBO(0), DepthRBO(0),
+		frame(0), last(0.0), begun(false) {
+		Options.Enabled = false;
+		Options.Width = width;
+		Options.Height = height;
+		Options.Warmup = HEADLESS_WARMUP_FRAMES;
+		Options.Frames = HEADLESS_FRAMES;
+		std::fill(queries, queries + 2 * HEADLESS_QUERY_FRAMES, 0);
+		std::fill(pending, pending + HEADLESS_QUERY_FRAMES, false);
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--headless") Options.Enabled = true;
+			else if (arg == "--size" && i + 1 < argc) {
+				unsigned int w, h;
+				if (std::sscanf(argv[++i], "%ux%u", &w, &h) == 2 && w > 0 && h > 0) {
+					Options.Width = w;
+					Options.Height = h;
+				}
+				else std::cout << "ERROR::HEADLESS::INVALID_SIZE: " << argv[i] << std::endl;
+			}
+			else if (arg == "--warmup" && i + 1 < argc) Options.Warmup = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+			else if (arg == "--frames" && i + 1 < argc) Options.Frames = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+			else if (arg == "--bench" && i + 1 < argc) Options.Bench = argv[++i];
+			else Arguments.push_back(arg);
+		}
+	}
+
+	// initializes GLFW in place of glfwInit()
+	bool init() {
+		if (Options.Enabled) {
+#ifdef GLFW_PLATFORM_NULL
+			glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+			std::cout << "ERROR::HEADLESS::NULL_PLATFORM_NOT_AVAILABLE, GLFW 3.4 is needed to run without a display" << std::endl;
+#endif
+		}
+		return glfwInit() == GLFW_TRUE;
+	}
+
+	// creates the window in place of glfwCreateWindow(), after the context hints
+	GLFWwindow* createWindow(unsigned int width, unsigned int height, const char* title) {
+		if (!Options.Enabled) return glfwCreateWindow(width, height, title, NULL, NULL);
+		scene = title;
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+		GLFWwindow* window = glfwCreateWindow(Options.Width, Options.Height, title, NULL, NULL);
+#ifdef GLFW_OSMESA_CONTEXT_API
+		if (window == NULL) {
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+			window = glfwCreateWindow(Options.Width, Options.Height, title, NULL, NULL);
+		}
+#endif
+		return window;
+	}
+
+	// Creates and binds the offscreen framebuffer once GL is loaded. Code
+	// binding the default framebuffer must bind framebuffer() instead.
+	bool setup() {
+		if (!Options.Enabled) return true;
+		GLResources &resources = GLResources::get();
+		ColorBuffer = resources.createRenderbuffer();
+		ColorRBO = resources.name(ColorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, ColorRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Options.Width, Options.Height);
+		resources.setMemory(ColorBuffer, (size_t)Options.Width * Options.Height * 4);
+		DepthBuffer = resources.createRenderbuffer();
+		DepthRBO = resources.name(DepthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, DepthRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Options.Width, Options.Height);
+		resources.setMemory(DepthBuffer, (size_t)Options.Width * Options.Height * 4);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		Framebuffer = resources.createFramebuffer();
+		FBO = resources.name(Framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorRBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, DepthRBO);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "ERROR::HEADLESS::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+			return false;
+		}
+		glViewport(0, 0, Options.Width, Options.Height);
+		glGenQueries(2 * HEADLESS_QUERY_FRAMES, queries);
+		renderer = (const char*)glGetString(GL_RENDERER);
+		std::cout << "HEADLESS::" << Options.Width << "x" << Options.Height << ", " << Options.Warmup << " + " << Options.Frames
+			<< " frames on " << renderer << std::endl;
+		return true;
+	}
+
+	// the framebuffer standing in for the default one
+	unsigned int framebuffer() const {
+		return FBO;
+	}
+
+	// size of the framebuffer drawn to
+	unsigned int width() const {
+		return Options.Width;
+	}
+	unsigned int height() const {
+		return Options.Height;
+	}
+
+	// call at the start of every frame, before its first GL command
+	void beginFrame() {
+		if (!Options.Enabled) return;
+		// the first frame has no previous end, its CPU time starts here
+		if (frame == 0) last = glfwGetTime();
+		glQueryCounter(queries[2 * (frame % HEADLESS_QUERY_FRAMES)], GL_TIMESTAMP);
+		begun = true;
+	}
+
+	// call after every rendered frame, closes the window after the last one
+	void endFrame(GLFWwindow* window) {
+		if (!Options.Enabled) return;
+		double now = glfwGetTime();
+		unsigned int slot = frame % HEADLESS_QUERY_FRAMES;
+		if (begun) glQueryCounter(queries[2 * slot + 1], GL_TIMESTAMP);
+		pending[slot] = begun && frame >= Options.Warmup;
+		begun = false;
+		if (frame >= Options.Warmup) CpuTimes.push_back((now - last) * 1000.0);
+		last = now;
+		++frame;
+		// the slot of the next frame is read back before it is reused
+		readTimestamps(frame % HEADLESS_QUERY_FRAMES);
+		if (frame < Options.Warmup + Options.Frames) return;
+		glFinish();
+		for (unsigned int i = 0; i < HEADLESS_QUERY_FRAMES; ++i)
+			readTimestamps(i);
+		report();
+		glfwSetWindowShouldClose(window, GLFW_TRUE);
+	}
+
+	// mean, median, 99th percentile and maximum of frame times
+	static FrameTimeStats summarize(std::vector<double> times) {
+		FrameTimeStats stats = { (unsigned int)times.size(), 0.0, 0.0, 0.0, 0.0 };
+		if (times.empty()) return stats;
+		std::sort(times.begin(), times.end());
+		for (double time : times) stats.Mean += time;
+		stats.Mean /= times.size();
+		// nearest rank
+		stats.P50 = times[(times.size() * 50 + 99) / 100 - 1];
+		stats.P99 = times[(times.size() * 99 + 99) / 100 - 1];
+		stats.Max = times.back();
+		return stats;
+	}
+
+	// de-allocate GL objects, must be called while the context is alive
+	void release() {
+		if (queries[0] != 0) glDeleteQueries(2 * HEADLESS_QUERY_FRAMES, queries);
+		std::fill(queries, queries + 2 * HEADLESS_QUERY_FRAMES, 0);
+		GLResources &resources = GLResources::get();
+		resources.destroy(Framebuffer);
+		resources.destroy(ColorBuffer);
+		resources.destroy(DepthBuffer);
+		FBO = ColorRBO = DepthRBO = 0;
+	}
+
+private:
+	std::string scene, renderer;
+	unsigned int frame;
+	double last;
+	// begin and end timestamp of the frames in flight
+	GLuint queries[2 * HEADLESS_QUERY_FRAMES];
+	bool pending[HEADLESS_QUERY_FRAMES];
+	bool begun;
+
+	void readTimestamps(unsigned int slot) {
+		if (!pending[slot]) return;
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(queries[2 * slot], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(queries[2 * slot + 1], GL_QUERY_RESULT, &end);
+		GpuTimes.push_back((end - begin) / 1.0e6);
+		pending[slot] = false;
+	}
+
+	static void writeStats(std::ostream &out, const char* name, const FrameTimeStats &stats) {
+		out << "\"" << name << "\":";
+		if (stats.Samples == 0) {
+			out << "null";
+			return;
+		}
+		out << "{\"mean\":" << stats.Mean << ",\"p50\":" << stats.P50 << ",\"p99\":" << stats.P99 << ",\"max\":" << stats.Max << "}";
+	}
+
+	// escapes a string for JSON
+	static std::string quote(const std::string &text) {
+		std::string quoted = "\"";
+		for (char c : text) {
+			if (c == '"' || c == '\\') quoted += '\\';
+			if ((unsigned char)c >= 0x20) quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	void report() const {
+		FrameTimeStats cpu = summarize(CpuTimes), gpu = summarize(GpuTimes);
+		std::cout << "HEADLESS::" << scene << ": " << cpu.Samples << " frames, CPU mean " << cpu.Mean << " p50 " << cpu.P50
+			<< " p99 " << cpu.P99 << " max " << cpu.Max << " ms, GPU mean " << gpu.Mean << " p50 " << gpu.P50
+			<< " p99 " << gpu.P99 << " max " << gpu.Max << " ms" << std::endl;
+		if (Options.Bench.empty()) return;
+		std::ofstream file(Options.Bench);
+		if (!file) {
+			std::cout << "ERROR::HEADLESS::BENCH_NOT_WRITTEN: " << Options.Bench << std::endl;
+			return;
+		}
+		file.setf(std::ios::fixed);
+		file.precision(4);
+		file << "{\"scene\":" << quote(scene) << ",\"renderer\":" << quote(renderer)
+			<< ",\"width\":" << Options.Width << ",\"height\":" << Options.Height
+			<< ",\"warmup\":" << Options.Warmup << ",\"frames\":" << Options.Frames << ",";
+		writeStats(file, "cpu_ms", cpu);
+		file << ",";
+		writeStats(file, "gpu_ms", gpu);
+		file << "}\n";
+	}
+};
+
+#endif // !HEADLESS_H
@@ -8,6 +8,10 @@
 #include <iostream>
 #include <vector>
 
+#include "dynamic_buffer.h"
+#include "gl_resources.h"
+#include "headless.h"
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 
@@ -32,11 +36,13 @@ const char* fragmentShaderSource = "#version 330 core\n"
 "	FragColor = vec4(ourColor, 1.0f);\n"
 "}\n";
 
-int main() {
+int main(int argc, char* argv[]) {
 	// Initialize and configure GLFW
 	// Version: 3.3
 	// Profile: CORE
-	glfwInit();
+	// --headless renders offscreen without a display, see headless.h
+	Headless headless(argc, argv, WIDTH, HEIGHT);
+	headless.init();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -44,7 +50,7 @@ int main() {
 	// Create GLFW window
 	// Width:  800
 	// Height: 600
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Colorful Triangle", NULL, NULL);
+	GLFWwindow* window = headless.createWindow(WIDTH, HEIGHT, "Colorful Triangle");
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window." << std::endl;
 		glfwTerminate();
@@ -59,6 +65,15 @@ int main() {
 		return -1;
 	}
 
+	// GL objects are pooled and counted, deleted once the GPU is done with them
+	GLResources &resources = GLResources::get();
+
+	// offscreen framebuffer of the headless mode
+	if (!headless.setup()) {
+		glfwTerminate();
+		return -1;
+	}
+
 	// Setup ImGui Context
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -102,42 +117,15 @@ int main() {
 		2, 0    // 3rd line
 	};
 
-	unsigned int VAOs[2], VBOs[2], EBOs[2];
-	glGenVertexArrays(2, VAOs);
-	glGenBuffers(2, VBOs);
-	glGenBuffers(2, EBOs);
-
-	// first VAO
-	glBindVertexArray(VAOs[0]);
+	// Postion attribute: location = 0, Color attribute: location = 1
+	// colors only change while they are edited, so the buffers are dynamic
+	DynamicBuffer triangle({ 3, 3 }, GL_DYNAMIC_DRAW);
+	triangle.set(triangle_vertices, sizeof(triangle_vertices));
+	triangle.setIndices(triangle_indices, 3);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_vertices), triangle_vertices, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[0]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(triangle_indices), triangle_indices, GL_STATIC_DRAW);
-
-	// Postion attribute: location = 0
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// Color attribute: location = 1
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
-	// second VAO
-	glBindVertexArray(VAOs[1]);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(line_vertices), line_vertices, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[1]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(line_indices), line_indices, GL_STATIC_DRAW);
-
-	// Postion attribute: location = 0
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// Color attribute: location = 1
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	DynamicBuffer lines({ 3, 3 }, GL_DYNAMIC_DRAW);
+	lines.set(line_vertices, sizeof(line_vertices));
+	lines.setIndices(line_indices, 6);
 
 	// build and compile shader program
 	// -------------------- vertex shader ---------------------------
@@ -161,7 +149,8 @@ int main() {
 		std::cout << "ERROR: FRAGMENT SHADER COMPILATION FAILED!\n" << infoLog << std::endl;
 	}
 	// --------------------- shader program ---------------------------
-	int shaderProgram = glCreateProgram();
+	ProgramHandle program = resources.createProgram();
+	int shaderProgram = resources.name(program);
 	glAttachShader(shaderProgram, vertexShader);
 	glAttachShader(shaderProgram, fragmentShader);
 	glLinkProgram(shaderProgram);
@@ -177,6 +166,7 @@ int main() {
 	glUseProgram(shaderProgram);
 
 	while (!glfwWindowShouldClose(window)) {
+		headless.beginFrame();
 		processInput(window);
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
@@ -202,6 +192,7 @@ int main() {
 				line_vertices[i * 6 + 5] = colors[i].z;
 			}
 
+			ImGui::Text("Uploaded: %zu bytes", triangle.Uploaded + lines.Uploaded);
 			ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 			ImGui::End();
 		}
@@ -210,30 +201,37 @@ int main() {
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		glBindVertexArray(VAOs[0]);
-		glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_vertices), triangle_vertices, GL_STATIC_DRAW);
+		// only the colors that changed are sent
+		triangle.set(triangle_vertices, sizeof(triangle_vertices));
+		triangle.upload();
+		triangle.bind();
 		//glDrawArrays(GL_TRIANGLES, 0, 3);
 		glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
 
-		glBindVertexArray(VAOs[1]);
-		glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(line_vertices), line_vertices, GL_STATIC_DRAW);
+		lines.set(line_vertices, sizeof(line_vertices));
+		lines.upload();
+		lines.bind();
 		//glDrawArrays(GL_TRIANGLES, 0, 3);
 		glDrawElements(GL_LINES, 6, GL_UNSIGNED_INT, 0);
 
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+		resources.endFrame();
+
 		// swap buffers and poll IO events
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		headless.endFrame(window);
 	}
 
 	// cleanup
-	glDeleteVertexArrays(2, VAOs);
-	glDeleteBuffers(2, VBOs);
-	glDeleteBuffers(2, EBOs);
+	triangle.release();
+	lines.release();
+	resources.destroy(program);
+	headless.release();
+	// anything still alive now is reported as a leak
+	resources.release();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
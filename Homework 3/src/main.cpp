@@ -8,6 +8,9 @@
 #include <iostream>
 #include <math.h>
 
+#include "gl_resources.h"
+#include "headless.h"
+
 const unsigned int WIDTH = 600;
 const unsigned int HEIGHT = 600;
 const int MESH_NUM = 21;
@@ -45,12 +48,14 @@ void setMesh(float mesh_vertices_row[], float mesh_vertices_col[], float scale);
 void setZs(float points[], int length, float value, int step);
 void setColors(float points[], int length, float r, float g, float b);
 
-int main() {
+int main(int argc, char* argv[]) {
 	//----------------------------------------------------------------
 	// Initialize and configure GLFW
 	// Version: 3.3
 	// Profile: CORE
-	glfwInit();
+	// --headless renders offscreen without a display, see headless.h
+	Headless headless(argc, argv, WIDTH, HEIGHT);
+	headless.init();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -58,7 +63,7 @@ int main() {
 	// Create GLFW window
 	// Width:  800
 	// Height: 600
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Bresenham", NULL, NULL);
+	GLFWwindow* window = headless.createWindow(WIDTH, HEIGHT, "Bresenham");
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window." << std::endl;
 		glfwTerminate();
@@ -73,6 +78,12 @@ int main() {
 		return -1;
 	}
 
+	// offscreen framebuffer of the headless mode
+	if (!headless.setup()) {
+		glfwTerminate();
+		return -1;
+	}
+
 	// Setup ImGui Context
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -93,15 +104,17 @@ int main() {
 
 	setMesh(mesh_vertices_row, mesh_vertices_col, SCALE);
 
-	unsigned int VAOs[2], VBOs[2];
-	glGenVertexArrays(2, VAOs);
-	glGenBuffers(2, VBOs);
+	// GL objects are pooled, live ones are counted in the menu bar
+	GLResources &resources = GLResources::get();
+	VertexArrayHandle VAOs[2] = { resources.createVertexArray(), resources.createVertexArray() };
+	BufferHandle VBOs[2] = { resources.createBuffer(), resources.createBuffer() };
 
 	// First VAO for row mesh
-	glBindVertexArray(VAOs[0]);
+	glBindVertexArray(resources.name(VAOs[0]));
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, resources.name(VBOs[0]));
 	glBufferData(GL_ARRAY_BUFFER, sizeof(mesh_vertices_row), mesh_vertices_row, GL_STATIC_DRAW);
+	resources.setMemory(VBOs[0], sizeof(mesh_vertices_row));
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
@@ -109,10 +122,23 @@ int main() {
 	glEnableVertexAttribArray(1);
 
 	// Second VAO for col mesh
-	glBindVertexArray(VAOs[1]);
+	glBindVertexArray(resources.name(VAOs[1]));
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
+	glBindBuffer(GL_ARRAY_BUFFER, resources.name(VBOs[1]));
 	glBufferData(GL_ARRAY_BUFFER, sizeof(mesh_vertices_col), mesh_vertices_col, GL_STATIC_DRAW);
+	resources.setMemory(VBOs[1], sizeof(mesh_vertices_col));
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+
+	// Third VAO for the rasterized primitive, refilled every frame
+	VertexArrayHandle PRIMITIVE_VAO = resources.createVertexArray();
+	BufferHandle PRIMITIVE_VBO = resources.createBuffer();
+	glBindVertexArray(resources.name(PRIMITIVE_VAO));
+
+	glBindBuffer(GL_ARRAY_BUFFER, resources.name(PRIMITIVE_VBO));
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
@@ -141,7 +167,8 @@ int main() {
 		std::cout << "ERROR: FRAGMENT SHADER COMPILATION FAILED!\n" << infoLog << std::endl;
 	}
 	// --------------------- shader program ---------------------------
-	int shaderProgram = glCreateProgram();
+	ProgramHandle program = resources.createProgram();
+	int shaderProgram = resources.name(program);
 	glAttachShader(shaderProgram, vertexShader);
 	glAttachShader(shaderProgram, fragmentShader);
 	glLinkProgram(shaderProgram);
@@ -162,6 +189,7 @@ int main() {
 	int radius = 1;
 
 	while (!glfwWindowShouldClose(window)) {
+		headless.beginFrame();
 		processInput(window);
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
@@ -172,10 +200,10 @@ int main() {
 		glClear(GL_COLOR_BUFFER_BIT);
 		glPointSize(16);
 		// Draw row mesh
-		glBindVertexArray(VAOs[0]);
+		glBindVertexArray(resources.name(VAOs[0]));
 		glDrawArrays(GL_LINES, 0, MESH_NUM * 2);
 		// Draw col mesh
-		glBindVertexArray(VAOs[1]);
+		glBindVertexArray(resources.name(VAOs[1]));
 		glDrawArrays(GL_LINES, 0, MESH_NUM * 2);
 
 		if (ImGui::BeginMainMenuBar()) {
@@ -185,27 +213,29 @@ int main() {
 				if (ImGui::MenuItem("Circle")) { primitive_type = 3; }
 				ImGui::EndMenu();
 			}
+			const GLResourceStats &resourceStats = resources.stats();
+			ImGui::Text("GL objects: %u live, %.1f KB", resourceStats.liveNum(), resourceStats.memory() / 1024.0);
 			ImGui::EndMainMenuBar();
 		}
 
 		if (primitive_type == 1) {
 			ImGui::Begin("Line Input");
 
-			ImGui::BeginChild("X1", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("X1", ImVec2(150, 20), false);
 			ImGui::SliderInt("X1", &x1, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 			ImGui::SameLine();
 
-			ImGui::BeginChild("Y1", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("Y1", ImVec2(150, 20), false);
 			ImGui::SliderInt("Y1", &y1, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 
-			ImGui::BeginChild("X2", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("X2", ImVec2(150, 20), false);
 			ImGui::SliderInt("X2", &x2, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 			ImGui::SameLine();
 
-			ImGui::BeginChild("Y2", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("Y2", ImVec2(150, 20), false);
 			ImGui::SliderInt("Y2", &y2, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 
@@ -217,19 +247,11 @@ int main() {
 			setZs(points, length, 0.0f, 6);
 			setColors(points, length, 1.0f, 0.0f, 0.0f);
 
-			unsigned int LINE_VAO, LINE_VBO;
-			glGenVertexArrays(1, &LINE_VAO);
-			glGenBuffers(1, &LINE_VBO);
-
-			glBindVertexArray(LINE_VAO);
+			glBindVertexArray(resources.name(PRIMITIVE_VAO));
 
-			glBindBuffer(GL_ARRAY_BUFFER, LINE_VBO);
-			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points, GL_STATIC_DRAW);
-
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-			glEnableVertexAttribArray(1);
+			glBindBuffer(GL_ARRAY_BUFFER, resources.name(PRIMITIVE_VBO));
+			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points, GL_STREAM_DRAW);
+			resources.setMemory(PRIMITIVE_VBO, length * sizeof(float));
 
 			glPointSize(16);
 			glDrawArrays(GL_POINTS, 0, length / 6);
@@ -238,30 +260,30 @@ int main() {
 		}
 		else if (primitive_type == 2) {
 			ImGui::Begin("Triangle Input");
-			ImGui::BeginChild("X1", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("X1", ImVec2(150, 20), false);
 			ImGui::SliderInt("X1", &x1, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 			ImGui::SameLine();
 
-			ImGui::BeginChild("Y1", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("Y1", ImVec2(150, 20), false);
 			ImGui::SliderInt("Y1", &y1, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 
-			ImGui::BeginChild("X2", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("X2", ImVec2(150, 20), false);
 			ImGui::SliderInt("X2", &x2, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 			ImGui::SameLine();
 
-			ImGui::BeginChild("Y2", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("Y2", ImVec2(150, 20), false);
 			ImGui::SliderInt("Y2", &y2, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 			
-			ImGui::BeginChild("X3", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("X3", ImVec2(150, 20), false);
 			ImGui::SliderInt("X3", &x3, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 			ImGui::SameLine();
 
-			ImGui::BeginChild("Y3", ImVec2(150, 20), FALSE);
+			ImGui::BeginChild("Y3", ImVec2(150, 20), false);
 			ImGui::SliderInt("Y3", &y3, -MESH_NUM / 2, MESH_NUM / 2);
 			ImGui::EndChild();
 
@@ -274,31 +296,25 @@ int main() {
 			setZs(points_1, length, 0.0f, 6);
 			setColors(points_1, length, 1.0f, 0.0f, 0.0f);
 
-			unsigned int LINE_VAO, LINE_VBO;
-			glGenVertexArrays(1, &LINE_VAO);
-			glGenBuffers(1, &LINE_VBO);
-
-			glBindVertexArray(LINE_VAO);
+			glBindVertexArray(resources.name(PRIMITIVE_VAO));
 
-			glBindBuffer(GL_ARRAY_BUFFER, LINE_VBO);
-			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points_1, GL_STATIC_DRAW);
-
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-			glEnableVertexAttribArray(1);
+			glBindBuffer(GL_ARRAY_BUFFER, resources.name(PRIMITIVE_VBO));
+			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points_1, GL_STREAM_DRAW);
+			resources.setMemory(PRIMITIVE_VBO, length * sizeof(float));
 			glDrawArrays(GL_POINTS, 0, length / 6);
 
 			length = Bresenham_line(x1, y1, x3, y3, points_2, SCALE);
 			setZs(points_2, length, 0.0f, 6);
 			setColors(points_2, length, 1.0f, 0.0f, 0.0f);
-			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points_2, GL_STATIC_DRAW);
+			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points_2, GL_STREAM_DRAW);
+			resources.setMemory(PRIMITIVE_VBO, length * sizeof(float));
 			glDrawArrays(GL_POINTS, 0, length / 6);
 
 			length = Bresenham_line(x2, y2, x3, y3, points_3, SCALE);
 			setZs(points_3, length, 0.0f, 6);
 			setColors(points_3, length, 1.0f, 0.0f, 0.0f);
-			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points_3, GL_STATIC_DRAW);
+			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points_3, GL_STREAM_DRAW);
+			resources.setMemory(PRIMITIVE_VBO, length * sizeof(float));
 			glDrawArrays(GL_POINTS, 0, length / 6);
 
 			delete[]points_1;
@@ -316,19 +332,11 @@ int main() {
 			setZs(points, length, 0.0f, 6);
 			setColors(points, length, 1.0f, 0.0f, 0.0f);
 
-			unsigned int CIRCLE_VAO, CIRCLE_VBO;
-			glGenVertexArrays(1, &CIRCLE_VAO);
-			glGenBuffers(1, &CIRCLE_VBO);
-
-			glBindVertexArray(CIRCLE_VAO);
-
-			glBindBuffer(GL_ARRAY_BUFFER, CIRCLE_VBO);
-			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points, GL_STATIC_DRAW);
+			glBindVertexArray(resources.name(PRIMITIVE_VAO));
 
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-			glEnableVertexAttribArray(1);
+			glBindBuffer(GL_ARRAY_BUFFER, resources.name(PRIMITIVE_VBO));
+			glBufferData(GL_ARRAY_BUFFER, length * sizeof(float), points, GL_STREAM_DRAW);
+			resources.setMemory(PRIMITIVE_VBO, length * sizeof(float));
 
 			glPointSize(16);
 			glDrawArrays(GL_POINTS, 0, length / 6);
@@ -342,14 +350,25 @@ int main() {
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+		resources.endFrame();
+
 		// swap buffers and poll IO events
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		headless.endFrame(window);
 	}
 
 	// cleanup
-	glDeleteVertexArrays(2, VAOs);
-	glDeleteBuffers(2, VBOs);
+	for (int i = 0; i < 2; ++i) {
+		resources.destroy(VAOs[i]);
+		resources.destroy(VBOs[i]);
+	}
+	resources.destroy(PRIMITIVE_VAO);
+	resources.destroy(PRIMITIVE_VBO);
+	resources.destroy(program);
+	headless.release();
+	// anything still alive now is reported as a leak
+	resources.release();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
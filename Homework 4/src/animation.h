@@ -0,0 +1,310 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+// Defines how values between two keys are computed
+enum Interpolation {
+	STEP,    // hold the value of the previous key
+	LINEAR,  // lerp for vectors, slerp for rotations
+	HERMITE  // cubic hermite for vectors (Catmull-Rom tangents unless given), slerp for rotations
+};
+
+const unsigned int NO_TANGENTS = 0xFFFFFFFFu;
+
+// One animated channel. Its keys live in the pools of the AnimationClip that
+// created it: key times at Times[TimeFirst], values at ValueFirst of the
+// value pool of its type.
+struct Curve {
+	unsigned int TimeFirst;
+	unsigned int ValueFirst;
+	unsigned int Count;        // 0 keeps the channel at its default value
+	unsigned int TangentFirst; // NO_TANGENTS if tangents are derived from the keys
+	Interpolation Mode;
+
+	Curve() : TimeFirst(0), ValueFirst(0), Count(0), TangentFirst(NO_TANGENTS), Mode(LINEAR) {}
+};
+
+// Translation, rotation and scale channels of one object, combined as T * R * S
+struct TransformTrack {
+	Curve Translation;
+	Curve Rotation;
+	Curve Scale;
+};
+
+// Copy of the keys a vector curve is currently sampled between: times T0 to
+// T1 hold P0 to P1, M0 and M1 are the hermite tangents scaled by T1 - T0.
+// Times before the first or after the last key are a STEP segment.
+struct VectorSegment {
+	float T0, T1, InvDuration;
+	Interpolation Mode;
+	unsigned int Key; // first key of the segment in its curve
+	glm::vec3 P0, P1, M0, M1;
+};
+
+// Copy of the keys a rotation curve is currently sampled between
+struct RotationSegment {
+	float T0, T1, InvDuration;
+	Interpolation Mode;
+	unsigned int Key;
+	glm::quat Q0, Q1;
+	glm::vec2 Arc; // see AnimationClip::Arcs
+};
+
+// A set of transform tracks sharing one clock. All keys are stored in a few
+// flat pools instead of one allocation per curve. Every curve also keeps a
+// copy of the segment it was last sampled in, in one array per channel
+// indexed by track, so a frame streams through those arrays in order and only
+// reads the key pools when a curve enters another segment; forward playback
+// finds that segment in O(1), jumps fall back to a binary search. The arc of
+// every rotation segment is computed when its keys are added, so slerp costs
+// two sines.
+//
+// Sampling updates the segments of the sampled tracks and nothing else:
+// sampleRange() may run concurrently on disjoint track ranges, e.g. one per
+// worker thread, as long as no curves or tracks are added meanwhile.
+class AnimationClip {
+public:
+	// key pools shared by all curves
+	std::vector<float> Times;
+	std::vector<glm::vec3> Vectors;
+	std::vector<glm::quat> Rotations;
+	// angle and 1 / sin(angle) of the segment starting at each rotation key,
+	// (0, 0) for segments short enough to be lerped
+	std::vector<glm::vec2> Arcs;
+	std::vector<TransformTrack> Tracks;
+	// length of one loop, time wraps around if Loop is set
+	float Duration;
+	bool Loop;
+
+	AnimationClip(float duration = 0.0f, bool loop = true) : Duration(duration), Loop(loop) {}
+
+	// Adds a vector curve, `tangents` (per unit of time) are optional for HERMITE
+	Curve addCurve(const std::vector<float> &times, const std::vector<glm::vec3> &values, Interpolation mode, const std::vector<glm::vec3> &tangents = std::vector<glm::vec3>()) {
+		Curve curve = addTimes(times, mode);
+		curve.ValueFirst = (unsigned int)Vectors.size();
+		Vectors.insert(Vectors.end(), values.begin(), values.end());
+		if (!tangents.empty()) {
+			curve.TangentFirst = (unsigned int)Vectors.size();
+			Vectors.insert(Vectors.end(), tangents.begin(), tangents.end());
+		}
+		return curve;
+	}
+
+	// Adds a rotation curve, consecutive keys must be less than 180 degrees apart
+	Curve addCurve(const std::vector<float> &times, const std::vector<glm::quat> &values, Interpolation mode) {
+		Curve curve = addTimes(times, mode);
+		curve.ValueFirst = (unsigned int)Rotations.size();
+		for (unsigned int k = 0; k < values.size(); ++k) {
+			glm::quat q = values[k];
+			glm::vec2 arc(0.0f, 0.0f);
+			if (k > 0) {
+				// q and -q are the same rotation, take the shorter way like glm::slerp
+				float cosTheta = glm::dot(Rotations.back(), q);
+				if (cosTheta < 0.0f) {
+					q = -q;
+					cosTheta = -cosTheta;
+				}
+				if (cosTheta <= 1.0f - std::numeric_limits<float>::epsilon()) {
+					float theta = std::acos(cosTheta);
+					Arcs.back() = glm::vec2(theta, 1.0f / std::sin(theta));
+				}
+			}
+			Rotations.push_back(q);
+			Arcs.push_back(arc);
+		}
+		return curve;
+	}
+
+	// returns the index of the track
+	unsigned int addTrack(const TransformTrack &track) {
+		Tracks.push_back(track);
+		// empty segments, filled by the first sample
+		VectorSegment emptyVector = {};
+		emptyVector.T0 = 1.0f;
+		emptyVector.T1 = 0.0f;
+		RotationSegment emptyRotation = {};
+		emptyRotation.T0 = 1.0f;
+		emptyRotation.T1 = 0.0f;
+		translations.push_back(emptyVector);
+		rotations.push_back(emptyRotation);
+		scales.push_back(emptyVector);
+		Duration = std::max(Duration, std::max(endTime(track.Translation), std::max(endTime(track.Rotation), endTime(track.Scale))));
+		return (unsigned int)Tracks.size() - 1;
+	}
+
+	// model matrix of one track at `time`
+	glm::mat4 sample(unsigned int track, float time) {
+		return sampleTrack(track, localTime(time));
+	}
+
+	// Batch evaluation of `count` tracks starting at `first` at the same time,
+	// out[i] receives track first + i. Calls on disjoint ranges may overlap.
+	void sampleRange(unsigned int first, unsigned int count, float time, glm::mat4* out) {
+		float t = localTime(time);
+		for (unsigned int i = 0; i < count; ++i)
+			out[i] = sampleTrack(first + i, t);
+	}
+
+	// Batch evaluation of every track at the same time, out must hold
+	// Tracks.size() matrices
+	void sampleAll(float time, glm::mat4* out) {
+		sampleRange(0, (unsigned int)Tracks.size(), time, out);
+	}
+
+	// position of `time` within the clip
+	float localTime(float time) const {
+		if (!Loop || Duration <= 0.0f) return time;
+		float t = std::fmod(time, Duration);
+		return t < 0.0f ? t + Duration : t;
+	}
+
+	// T * R * S without going through three matrix products
+	static glm::mat4 compose(const glm::vec3 &translation, const glm::quat &rotation, const glm::vec3 &scale) {
+		glm::mat4 m = glm::mat4_cast(rotation);
+		m[0] = m[0] * scale.x;
+		m[1] = m[1] * scale.y;
+		m[2] = m[2] * scale.z;
+		m[3] = glm::vec4(translation, 1.0f);
+		return m;
+	}
+
+private:
+	// last sampled segment of every curve, one array per channel
+	std::vector<VectorSegment> translations, scales;
+	std::vector<RotationSegment> rotations;
+	// most recently stored block of key times
+	Curve lastTimes;
+
+	// Curves of one track usually share their key times, those are stored once
+	// so sampling the track reads them from cache
+	Curve addTimes(const std::vector<float> &times, Interpolation mode) {
+		Curve curve;
+		curve.Count = (unsigned int)times.size();
+		curve.Mode = mode;
+		if (lastTimes.Count == curve.Count && std::equal(times.begin(), times.end(), Times.begin() + lastTimes.TimeFirst)) {
+			curve.TimeFirst = lastTimes.TimeFirst;
+			return curve;
+		}
+		curve.TimeFirst = (unsigned int)Times.size();
+		Times.insert(Times.end(), times.begin(), times.end());
+		lastTimes = curve;
+		return curve;
+	}
+
+	float endTime(const Curve &curve) const {
+		return curve.Count ? Times[curve.TimeFirst + curve.Count - 1] : 0.0f;
+	}
+
+	glm::mat4 sampleTrack(unsigned int i, float t) {
+		VectorSegment &translation = translations[i];
+		RotationSegment &rotation = rotations[i];
+		VectorSegment &scale = scales[i];
+		if (!(t >= translation.T0 && t < translation.T1)) enter(Tracks[i].Translation, translation, t, glm::vec3(0.0f));
+		if (!(t >= rotation.T0 && t < rotation.T1)) enter(Tracks[i].Rotation, rotation, t);
+		if (!(t >= scale.T0 && t < scale.T1)) enter(Tracks[i].Scale, scale, t, glm::vec3(1.0f));
+		return compose(evaluate(translation, t), evaluate(rotation, t), evaluate(scale, t));
+	}
+
+	static glm::vec3 evaluate(const VectorSegment &segment, float t) {
+		if (segment.Mode == STEP) return segment.P0;
+		float u = (t - segment.T0) * segment.InvDuration;
+		if (segment.Mode == LINEAR) return segment.P0 + (segment.P1 - segment.P0) * u;
+
+		// cubic hermite basis
+		float u2 = u * u, u3 = u2 * u;
+		return segment.P0 * (2.0f * u3 - 3.0f * u2 + 1.0f) + segment.M0 * (u3 - 2.0f * u2 + u)
+			+ segment.P1 * (-2.0f * u3 + 3.0f * u2) + segment.M1 * (u3 - u2);
+	}
+
+	static glm::quat evaluate(const RotationSegment &segment, float t) {
+		if (segment.Mode == STEP) return segment.Q0;
+		float u = (t - segment.T0) * segment.InvDuration;
+		// slerp with the precomputed arc, keys are already in one hemisphere
+		if (segment.Arc.x == 0.0f) return segment.Q0 * (1.0f - u) + segment.Q1 * u;
+		return segment.Q0 * (std::sin((1.0f - u) * segment.Arc.x) * segment.Arc.y)
+			+ segment.Q1 * (std::sin(u * segment.Arc.x) * segment.Arc.y);
+	}
+
+	// Finds the segment [k, k + 1] containing t, times[0] <= t < times[last].
+	// Forward playback usually stays in the cached segment or enters the next one.
+	static unsigned int seek(const float* times, unsigned int last, unsigned int k, float t) {
+		k = std::min(k, last - 1);
+		if (t >= times[k] && t < times[k + 1]) return k;
+		if (k + 2 <= last && t >= times[k + 1] && t < times[k + 2]) return k + 1;
+		return (unsigned int)(std::upper_bound(times, times + last + 1, t) - times) - 1;
+	}
+
+	// Sets the segment bounds around t, returns false for a constant segment
+	// whose value is the key at `key`
+	bool bound(const Curve &curve, unsigned int &key, float &t0, float &t1, float &invDuration, float t) const {
+		const float infinity = std::numeric_limits<float>::infinity();
+		if (curve.Count < 2) {
+			key = 0;
+			t0 = -infinity;
+			t1 = infinity;
+			return false;
+		}
+		const float* times = &Times[curve.TimeFirst];
+		unsigned int last = curve.Count - 1;
+		// NaN, e.g. a looping clip sampled at an infinite time, holds the first
+		// key, it would fail every comparison of the segment search
+		if (!(t >= times[0])) {
+			key = 0;
+			t0 = -infinity;
+			t1 = times[0];
+			return false;
+		}
+		if (t >= times[last]) {
+			key = last;
+			t0 = times[last];
+			t1 = infinity;
+			return false;
+		}
+		key = seek(times, last, key, t);
+		t0 = times[key];
+		t1 = times[key + 1];
+		invDuration = 1.0f / (t1 - t0);
+		return true;
+	}
+
+	void enter(const Curve &curve, VectorSegment &segment, float t, const glm::vec3 &defaultValue) const {
+		bool inside = bound(curve, segment.Key, segment.T0, segment.T1, segment.InvDuration, t);
+		if (curve.Count == 0) segment.P0 = defaultValue;
+		else segment.P0 = Vectors[curve.ValueFirst + segment.Key];
+		segment.Mode = inside ? curve.Mode : STEP;
+		if (!inside) return;
+		segment.P1 = Vectors[curve.ValueFirst + segment.Key + 1];
+		if (curve.Mode != HERMITE) return;
+		float dt = segment.T1 - segment.T0;
+		segment.M0 = tangent(curve, segment.Key) * dt;
+		segment.M1 = tangent(curve, segment.Key + 1) * dt;
+	}
+
+	void enter(const Curve &curve, RotationSegment &segment, float t) const {
+		bool inside = bound(curve, segment.Key, segment.T0, segment.T1, segment.InvDuration, t);
+		if (curve.Count == 0) segment.Q0 = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		else segment.Q0 = Rotations[curve.ValueFirst + segment.Key];
+		segment.Mode = inside ? curve.Mode : STEP;
+		if (!inside) return;
+		segment.Q1 = Rotations[curve.ValueFirst + segment.Key + 1];
+		segment.Arc = Arcs[curve.ValueFirst + segment.Key];
+	}
+
+	// given tangent, or Catmull-Rom (one sided at the ends)
+	glm::vec3 tangent(const Curve &curve, unsigned int k) const {
+		if (curve.TangentFirst != NO_TANGENTS) return Vectors[curve.TangentFirst + k];
+		unsigned int a = k == 0 ? 0 : k - 1, b = std::min(k + 1, curve.Count - 1);
+		const float* times = &Times[curve.TimeFirst];
+		const glm::vec3* values = &Vectors[curve.ValueFirst];
+		return (values[b] - values[a]) / (times[b] - times[a]);
+	}
+};
+
+#endif // !ANIMATION_H
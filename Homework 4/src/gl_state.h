@@ -0,0 +1,147 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include "gl_resources.h"
+
+// Default state cache options
+const unsigned int GL_STATE_TEXTURE_UNITS = 16;
+const GLuint       GL_STATE_UNKNOWN       = 0xFFFFFFFFu;
+
+// Binding calls of the state cache, reset once per frame by the caller
+struct GLStateStats {
+	unsigned int Issued; // calls passed on to GL
+	unsigned int Elided; // calls skipped because GL already had that state
+};
+
+// Shadow copy of the binding state of the render context: programs, vertex
+// arrays, textures per unit, the framebuffer and the viewport. Binding through
+// it skips calls that would not change anything, so callers can simply bind
+// whatever they need before each draw.
+//
+// The copy is only right while every bind of these kinds goes through it.
+// Code binding on its own (the ImGui renderer) must be followed by
+// invalidate(), objects must be forgotten before they are deleted since GL
+// unbinds them and may hand out their names again. Only the context of the
+// render thread is tracked.
+class GLState {
+public:
+	GLStateStats Stats;
+
+	static GLState &get() {
+		static GLState state;
+		return state;
+	}
+
+	void useProgram(GLuint id) {
+		if (count(program != id)) {
+			glUseProgram(id);
+			program = id;
+		}
+	}
+
+	void bindVertexArray(GLuint id) {
+		if (count(vertexArray != id)) {
+			glBindVertexArray(id);
+			vertexArray = id;
+		}
+	}
+
+	// binds `id` to texture unit `unit`, switching the active unit only if needed
+	void bindTexture(unsigned int unit, GLenum target, GLuint id) {
+		if (unit >= GL_STATE_TEXTURE_UNITS) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(target, id);
+			activeUnit = GL_STATE_UNKNOWN;
+			Stats.Issued += 2;
+			return;
+		}
+		if (!count(textures[unit] != id || targets[unit] != target)) return;
+		if (count(activeUnit != unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			activeUnit = unit;
+		}
+		glBindTexture(target, id);
+		textures[unit] = id;
+		targets[unit] = target;
+	}
+
+	// binds `id` as draw and read framebuffer
+	void bindFramebuffer(GLuint id) {
+		if (count(framebuffer != id)) {
+			glBindFramebuffer(GL_FRAMEBUFFER, id);
+			framebuffer = id;
+		}
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		if (count(view[0] != x || view[1] != y || view[2] != width || view[3] != height)) {
+			glViewport(x, y, width, height);
+			view[0] = x;
+			view[1] = y;
+			view[2] = width;
+			view[3] = height;
+		}
+	}
+
+	// call before deleting an object that may be bound
+	void forgetProgram(GLuint id) {
+		if (program == id) program = GL_STATE_UNKNOWN;
+	}
+	void forgetVertexArray(GLuint id) {
+		if (vertexArray == id) vertexArray = GL_STATE_UNKNOWN;
+	}
+	void forgetTexture(GLuint id) {
+		for (GLuint &texture : textures)
+			if (texture == id) texture = GL_STATE_UNKNOWN;
+	}
+	void forgetFramebuffer(GLuint id) {
+		if (framebuffer == id) framebuffer = GL_STATE_UNKNOWN;
+	}
+	// any pooled object, install as GLResources::OnDelete
+	void forget(GLResourceType type, GLuint id) {
+		switch (type) {
+		case GL_RESOURCE_VERTEX_ARRAY: forgetVertexArray(id); break;
+		case GL_RESOURCE_TEXTURE:      forgetTexture(id); break;
+		case GL_RESOURCE_FRAMEBUFFER:  forgetFramebuffer(id); break;
+		case GL_RESOURCE_PROGRAM:      forgetProgram(id); break;
+		default: break;
+		}
+	}
+
+	// the next call of every kind goes to GL again
+	void invalidate() {
+		program = vertexArray = framebuffer = GL_STATE_UNKNOWN;
+		activeUnit = GL_STATE_UNKNOWN;
+		for (unsigned int i = 0; i < GL_STATE_TEXTURE_UNITS; ++i) {
+			textures[i] = GL_STATE_UNKNOWN;
+			targets[i] = GL_NONE;
+		}
+		view[0] = view[1] = view[2] = view[3] = -1;
+	}
+
+	void resetStats() {
+		Stats.Issued = Stats.Elided = 0;
+	}
+
+private:
+	GLuint program, vertexArray, framebuffer;
+	GLuint activeUnit;
+	GLuint textures[GL_STATE_TEXTURE_UNITS];
+	GLenum targets[GL_STATE_TEXTURE_UNITS];
+	GLint view[4];
+
+	GLState() {
+		invalidate();
+		resetStats();
+	}
+
+	bool count(bool changed) {
+		if (changed) ++Stats.Issued;
+		else ++Stats.Elided;
+		return changed;
+	}
+};
+
+#endif // !GL_STATE_H
@@ -10,24 +10,49 @@
 #include "imgui_impl_opengl3.h"
 
 #include "shader.h"
+#include "mesh.h"
+#include "gl_state.h"
+#include "gl_resources.h"
+#include "timestep.h"
+#include "animation.h"
+#include "headless.h"
+#include "frame_capture.h"
 
 #include <iostream>
 #include <math.h>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
+Curve sineCurve(AnimationClip &clip, float offset, float amplitude, const glm::vec3 &direction);
+Curve spinCurve(AnimationClip &clip, float turns, const glm::vec3 &axis, const glm::quat &base);
 
 const unsigned int WIDTH = 800;
 const unsigned int HEIGHT = 600;
 
 const char* glsl_version = "#version 330 core";
 
-int main() {
+// tracks of the transform animation, one loop lasts 2 pi seconds
+enum Transform_Track {
+	TRANSLATION_TRACK,
+	ROTATION_TRACK,
+	SCALING_TRACK,
+	ORBIT_TRACK,     // carries the surrounding object around the center
+	SATELLITE_TRACK, // surrounding object relative to its orbit
+	CENTER_TRACK,
+	TRACK_NUM
+};
+const float        LOOP_DURATION = 6.2831853f;
+const unsigned int KEYS_PER_TURN = 4; // rotation keys per full turn, slerp needs less than 180 degrees between keys
+
+int main(int argc, char* argv[]) {
 	//----------------------------------------------------------------
 	// Initialize and configure GLFW
 	// Version: 3.3
 	// Profile: CORE
-	glfwInit();
+	// --headless renders offscreen without a display, see headless.h
+	Headless headless(argc, argv, WIDTH, HEIGHT);
+	headless.init();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -35,7 +60,7 @@ int main() {
 	// Create GLFW window
 	// Width:  800
 	// Height: 600
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Transform", NULL, NULL);
+	GLFWwindow* window = headless.createWindow(WIDTH, HEIGHT, "Transform");
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window." << std::endl;
 		glfwTerminate();
@@ -50,6 +75,19 @@ int main() {
 		return -1;
 	}
 
+	// every GL object lives in pools that count it, deleted ones are dropped
+	// from the state cache
+	GLResources &resources = GLResources::get();
+	resources.OnDelete = [](GLResourceType type, GLuint name) { GLState::get().forget(type, name); };
+
+	// offscreen framebuffer of the headless mode
+	if (!headless.setup()) {
+		glfwTerminate();
+		return -1;
+	}
+	// --capture DIR writes every frame to DIR, see frame_capture.h
+	FrameCapture capture(headless.Arguments, headless.width(), headless.height());
+
 	// Setup ImGui Context
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -115,32 +153,47 @@ int main() {
 		-2.0f,  2.0f, -2.0f, 0.0f, 0.0f, 1.0f,
 	};
 
-	unsigned int VAO, VBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-
-	glBindVertexArray(VAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	// indexed cube, vertices are deduplicated and reordered for the vertex cache
+	Mesh cube(vertices, sizeof(vertices) / sizeof(float), { 3, 3 });
+	cube.printStats("cube");
 
 	int transform_type = 0;
 
 	// place projection outside the render loop
 	shader.use();
 	glm::mat4 projection = glm::mat4(1.0f);
-	projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+	projection = glm::perspective(glm::radians(45.0f), (float)headless.width() / (float)headless.height(), 0.1f, 100.0f);
 	shader.setMat4("projection", projection);
 
+	// animation is driven by a fixed-step simulation clock instead of the frame rate
+	FixedTimestep timestep;
+
+	// the transforms as keyframed tracks, sampled together once per frame
+	AnimationClip clip(LOOP_DURATION);
+	glm::vec3 diagonal = glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)), up(0.0f, 1.0f, 0.0f);
+	glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+	TransformTrack tracks[TRACK_NUM];
+	tracks[TRANSLATION_TRACK].Translation = sineCurve(clip, 0.0f, 4.0f, glm::vec3(1.0f, 0.0f, 0.0f));
+	tracks[ROTATION_TRACK].Rotation = spinCurve(clip, 1.0f, diagonal, identity);
+	tracks[SCALING_TRACK].Scale = sineCurve(clip, 1.0f, 0.5f, glm::vec3(1.0f));
+	tracks[ORBIT_TRACK].Rotation = spinCurve(clip, 1.0f, up, identity);
+	tracks[SATELLITE_TRACK].Translation = clip.addCurve({ 0.0f }, std::vector<glm::vec3>{ glm::vec3(0.0f, 0.0f, 15.0f) }, STEP);
+	tracks[SATELLITE_TRACK].Rotation = spinCurve(clip, 5.0f, up, identity);
+	tracks[SATELLITE_TRACK].Scale = clip.addCurve({ 0.0f }, std::vector<glm::vec3>{ glm::vec3(0.5f) }, STEP);
+	tracks[CENTER_TRACK].Rotation = spinCurve(clip, 1.0f, up, glm::angleAxis(glm::radians(45.0f), diagonal));
+	tracks[CENTER_TRACK].Scale = clip.addCurve({ 0.0f }, std::vector<glm::vec3>{ glm::vec3(1.2f) }, STEP);
+	for (const TransformTrack &track : tracks) clip.addTrack(track);
+	std::vector<glm::mat4> transforms(TRACK_NUM);
+
 	// render loop
 	while (!glfwWindowShouldClose(window)) {
+		headless.beginFrame();
+		// advance simulation clock, the transforms are pure functions of time so
+		// rendering only needs the interpolated time between the last two ticks
+		timestep.advance(glfwGetTime());
+		float simTime = (float)timestep.renderTime();
+		clip.sampleAll(simTime, transforms.data());
+
 		// input
 		processInput(window);
 
@@ -172,40 +225,30 @@ int main() {
 		// Translation
 		// -----------
 		if (transform_type == 1) {
-			model = glm::translate(model, glm::vec3((float)sin(glfwGetTime()) * 4, 0.0f, 0.0f));
+			model = transforms[TRANSLATION_TRACK];
 		}
 		// Rotation
 		// --------
 		else if (transform_type == 2) {
-			model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(1.0f, 0.0f, 1.0f));
+			model = transforms[ROTATION_TRACK];
 		}
 		// Scaling
 		// -------
 		else if (transform_type == 3) {
-			float scale = (float)sin(glfwGetTime()) / 2 + 1;
-			model = glm::scale(model, glm::vec3(scale, scale, scale));
+			model = transforms[SCALING_TRACK];
 		}
 		// Combination
 		// -----------
 		else if (transform_type == 4) {
 			// Zoom out
-			float surrounding_object_scale = 0.5;
 			view = glm::translate(view, glm::vec3(0.0f, 0.0f, -20.0f));
-			model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
-			model = glm::translate(model, glm::vec3(0.0f, 0.0f, 15.0f));
-			model = glm::rotate(model, (float)glfwGetTime() * 5, glm::vec3(0.0f, 1.0f, 0.0f));
-			model = glm::scale(model, glm::vec3(surrounding_object_scale, surrounding_object_scale, surrounding_object_scale));
+			// surrounding object: spins around itself while orbiting the center
+			model = transforms[ORBIT_TRACK] * transforms[SATELLITE_TRACK];
 			
 			// centering object
-			float centering_object_scale = 1.2;
-			glm::mat4 model2 = glm::mat4(1.0f);
-			model2 = glm::rotate(model2, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
-			model2 = glm::rotate(model2, glm::radians(45.0f), glm::vec3(1.0f, 0.0f, 1.0f));
-			model2 = glm::scale(model2, glm::vec3(centering_object_scale, centering_object_scale, centering_object_scale));
-			shader.setMat4("model", model2);
+			shader.setMat4("model", transforms[CENTER_TRACK]);
 			// render centering object
-			glBindVertexArray(VAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			cube.draw();
 		}
 
 		if (transform_type != 0) {
@@ -216,22 +259,33 @@ int main() {
 			shader.setMat4("model", model);
 			shader.setMat4("view", view);
 			// render box
-			glBindVertexArray(VAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			cube.draw();
 		}
 
+		// read the frame back before the UI is drawn over it
+		capture.capture();
+
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// the ImGui renderer binds its own objects behind the cache's back
+		GLState::get().invalidate();
+
+		resources.endFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		headless.endFrame(window);
 	}
 
 	// cleanup
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+	cube.release();
+	shader.release();
+	capture.release();
+	headless.release();
+	// anything still alive now is reported as a leak
+	resources.release();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -241,10 +295,36 @@ int main() {
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
 }
 
 void processInput(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
+}
+
+// offset + amplitude * sin(t) along direction over one loop, as hermite keys
+// every 45 degrees with exact tangents
+Curve sineCurve(AnimationClip &clip, float offset, float amplitude, const glm::vec3 &direction) {
+	std::vector<float> times;
+	std::vector<glm::vec3> values, tangents;
+	for (unsigned int i = 0; i <= 8; ++i) {
+		float t = LOOP_DURATION * i / 8;
+		times.push_back(t);
+		values.push_back(direction * (offset + amplitude * sin(t)));
+		tangents.push_back(direction * (amplitude * cos(t)));
+	}
+	return clip.addCurve(times, values, HERMITE, tangents);
+}
+
+// `turns` full turns around axis over one loop, applied after the base rotation
+Curve spinCurve(AnimationClip &clip, float turns, const glm::vec3 &axis, const glm::quat &base) {
+	std::vector<float> times;
+	std::vector<glm::quat> values;
+	unsigned int keys = (unsigned int)(turns * KEYS_PER_TURN);
+	for (unsigned int i = 0; i <= keys; ++i) {
+		times.push_back(LOOP_DURATION * i / keys);
+		values.push_back(glm::angleAxis(LOOP_DURATION * turns * i / keys, axis) * base);
+	}
+	return clip.addCurve(times, values, LINEAR);
 }
\ No newline at end of file
@@ -0,0 +1,319 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+#include "gl_state.h"
+#include "gl_resources.h"
+
+// Default mesh options
+const unsigned int FORSYTH_CACHE_SIZE = 32; // LRU size simulated by the optimizer
+const unsigned int FIFO_CACHE_SIZE    = 16; // FIFO size used to measure ACMR
+
+// Indexed triangle mesh with interleaved vertex attributes.
+// Vertices are deduplicated on construction and the index buffer is reordered
+// for the post-transform vertex cache (Tom Forsyth, "Linear-Speed Vertex Cache
+// Optimisation").
+class Mesh {
+public:
+	// interleaved vertex data, Stride floats per vertex
+	std::vector<float> Vertices;
+	std::vector<unsigned int> Indices;
+	// number of floats of each attribute, e.g. {3, 3, 2} for position/normal/texcoord
+	std::vector<int> Layout;
+	unsigned int Stride;
+	// Average cache miss ratio of the input, of the deduplicated and of the optimized indices
+	float ACMR[3];
+	// counts uploaded to the GPU
+	unsigned int VertexCount, IndexCount;
+	unsigned int VAO, VBO, EBO;
+	// the same objects in the GLResources pool
+	VertexArrayHandle VertexArray;
+	BufferHandle VertexBuffer, ElementBuffer;
+
+	Mesh() : Stride(0), VertexCount(0), IndexCount(0), VAO(0), VBO(0), EBO(0) {
+		ACMR[0] = ACMR[1] = ACMR[2] = 0.0f;
+	}
+
+	// Builds an indexed mesh from a non-indexed triangle list of `count` floats
+	Mesh(const float* vertices, unsigned int count, const std::vector<int> &layout) : Mesh() {
+		Layout = layout;
+		for (int size : Layout) Stride += size;
+
+		unsigned int vertexCount = count / Stride;
+		std::vector<unsigned int> raw(vertexCount);
+		for (unsigned int i = 0; i < vertexCount; ++i) raw[i] = i;
+		ACMR[0] = computeACMR(raw, vertexCount);
+
+		deduplicate(vertices, vertexCount);
+		ACMR[1] = computeACMR(Indices, vertexNum());
+
+		optimizeVertexCache(Indices, vertexNum());
+		ACMR[2] = computeACMR(Indices, vertexNum());
+
+		setupMesh(Vertices.data(), vertexNum(), Indices.data(), (unsigned int)Indices.size());
+	}
+
+	// Builds a mesh from already indexed data, e.g. produced by a model loader
+	Mesh(std::vector<float> vertices, std::vector<unsigned int> indices, const std::vector<int> &layout, bool optimize = true) : Mesh() {
+		Layout = layout;
+		for (int size : Layout) Stride += size;
+		Vertices.swap(vertices);
+		Indices.swap(indices);
+
+		ACMR[0] = ACMR[1] = computeACMR(Indices, vertexNum());
+		if (optimize) optimizeVertexCache(Indices, vertexNum());
+		ACMR[2] = computeACMR(Indices, vertexNum());
+
+		setupMesh(Vertices.data(), vertexNum(), Indices.data(), (unsigned int)Indices.size());
+	}
+
+	// Uploads indexed data straight from memory, e.g. a mapped mesh cache,
+	// without keeping a CPU copy in Vertices/Indices
+	Mesh(const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const std::vector<int> &layout) : Mesh() {
+		Layout = layout;
+		for (int size : Layout) Stride += size;
+
+		ACMR[0] = ACMR[1] = ACMR[2] = computeACMR(indices, indexCount, vertexCount);
+
+		setupMesh(vertices, vertexCount, indices, indexCount);
+	}
+
+	unsigned int vertexNum() const {
+		return Stride == 0 ? 0 : (unsigned int)(Vertices.size() / Stride);
+	}
+
+	// render the mesh
+	void draw() const {
+		GLState::get().bindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, (GLsizei)IndexCount, GL_UNSIGNED_INT, 0);
+	}
+
+	// render several instances of the mesh in one call
+	void drawInstanced(unsigned int instanceCount) const {
+		GLState::get().bindVertexArray(VAO);
+		glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)IndexCount, GL_UNSIGNED_INT, 0, (GLsizei)instanceCount);
+	}
+
+	// prints vertex counts and ACMR before/after optimization
+	void printStats(const std::string &name) const {
+		std::cout << "MESH::" << name << ": "
+			<< IndexCount / 3 << " triangles, " << VertexCount << " vertices, ACMR "
+			<< ACMR[0] << " (unindexed) -> " << ACMR[1] << " (indexed) -> "
+			<< ACMR[2] << " (optimized)" << std::endl;
+	}
+
+	// de-allocate GL objects, must be called while the context is alive. They
+	// are deleted once the frames drawing them are done, see GLResources
+	void release() {
+		GLResources &resources = GLResources::get();
+		resources.destroy(VertexArray);
+		resources.destroy(VertexBuffer);
+		resources.destroy(ElementBuffer);
+		VAO = VBO = EBO = 0;
+		VertexCount = IndexCount = 0;
+	}
+
+	// Average number of vertex shader invocations per triangle, simulating a FIFO
+	// post-transform cache. 3.0 is the worst case, 0.5 the best case for large grids.
+	static float computeACMR(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize = FIFO_CACHE_SIZE) {
+		if (indexCount < 3) return 0.0f;
+		// cache entry of each vertex is valid while it is newer than `time - cacheSize`
+		std::vector<unsigned int> timestamp(vertexCount, 0);
+		unsigned int time = cacheSize + 1, misses = 0;
+		for (size_t i = 0; i < indexCount; ++i) {
+			if (time - timestamp[indices[i]] > cacheSize) {
+				timestamp[indices[i]] = time++;
+				++misses;
+			}
+		}
+		return (float)misses / (indexCount / 3);
+	}
+	static float computeACMR(const std::vector<unsigned int> &indices, unsigned int vertexCount, unsigned int cacheSize = FIFO_CACHE_SIZE) {
+		return computeACMR(indices.data(), indices.size(), vertexCount, cacheSize);
+	}
+
+	// Reorders the triangles of `indices` in place using Forsyth's greedy algorithm
+	static void optimizeVertexCache(std::vector<unsigned int> &indices, unsigned int vertexCount, unsigned int cacheSize = FORSYTH_CACHE_SIZE) {
+		unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+		if (triangleCount == 0) return;
+
+		// vertex -> triangles adjacency, stored as offsets into one array
+		std::vector<unsigned int> remaining(vertexCount, 0), offsets(vertexCount + 1, 0);
+		for (unsigned int index : indices) ++remaining[index];
+		for (unsigned int v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+		std::vector<unsigned int> adjacency(indices.size()), fill(offsets.begin(), offsets.end() - 1);
+		for (unsigned int t = 0; t < triangleCount; ++t)
+			for (int k = 0; k < 3; ++k)
+				adjacency[fill[indices[t * 3 + k]]++] = t;
+
+		std::vector<int> cachePos(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount), triangleScore(triangleCount, 0.0f);
+		std::vector<bool> emitted(triangleCount, false);
+		for (unsigned int v = 0; v < vertexCount; ++v)
+			vertexScore[v] = score(-1, remaining[v], cacheSize);
+		for (unsigned int t = 0; t < triangleCount; ++t)
+			for (int k = 0; k < 3; ++k)
+				triangleScore[t] += vertexScore[indices[t * 3 + k]];
+
+		std::vector<unsigned int> result;
+		result.reserve(indices.size());
+		std::vector<unsigned int> cache, nextCache;
+		cache.reserve(cacheSize + 3);
+		nextCache.reserve(cacheSize + 3);
+
+		int best = bestTriangle(triangleScore);
+		unsigned int scanCursor = 0;
+		while (best >= 0) {
+			unsigned int t = (unsigned int)best;
+			emitted[t] = true;
+			const unsigned int* tri = &indices[t * 3];
+			for (int k = 0; k < 3; ++k) {
+				result.push_back(tri[k]);
+				// remove the triangle from the vertex's list of pending triangles
+				unsigned int v = tri[k];
+				unsigned int begin = offsets[v], end = begin + remaining[v];
+				for (unsigned int i = begin; i < end; ++i) {
+					if (adjacency[i] == t) {
+						adjacency[i] = adjacency[end - 1];
+						break;
+					}
+				}
+				--remaining[v];
+			}
+
+			// the emitted vertices move to the front of the LRU cache
+			nextCache.assign(tri, tri + 3);
+			for (unsigned int v : cache)
+				if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache.push_back(v);
+			for (unsigned int i = 0; i < nextCache.size(); ++i)
+				cachePos[nextCache[i]] = i < cacheSize ? (int)i : -1;
+
+			// rescore the vertices whose cache position changed and their triangles
+			for (unsigned int v : nextCache) {
+				float newScore = score(cachePos[v], remaining[v], cacheSize);
+				float diff = newScore - vertexScore[v];
+				vertexScore[v] = newScore;
+				for (unsigned int i = offsets[v]; i < offsets[v] + remaining[v]; ++i)
+					triangleScore[adjacency[i]] += diff;
+			}
+			if (nextCache.size() > cacheSize) nextCache.resize(cacheSize);
+			cache.swap(nextCache);
+
+			// the next triangle is the best one using a vertex still in the cache
+			best = -1;
+			float bestScore = -1.0f;
+			for (unsigned int v : cache) {
+				for (unsigned int i = offsets[v]; i < offsets[v] + remaining[v]; ++i) {
+					if (triangleScore[adjacency[i]] > bestScore) {
+						bestScore = triangleScore[adjacency[i]];
+						best = (int)adjacency[i];
+					}
+				}
+			}
+
+			// nothing connected to the cache is left, continue with the next pending triangle
+			if (best < 0) {
+				while (scanCursor < triangleCount && emitted[scanCursor]) ++scanCursor;
+				if (scanCursor < triangleCount) best = (int)scanCursor;
+			}
+		}
+		indices.swap(result);
+	}
+
+private:
+	// Merges bitwise identical vertices and fills Vertices/Indices
+	void deduplicate(const float* vertices, unsigned int vertexCount) {
+		unsigned int stride = Stride;
+		const float* base = vertices;
+		auto hash = [base, stride](unsigned int v) {
+			// FNV-1a over the vertex bytes
+			const unsigned char* bytes = (const unsigned char*)(base + v * stride);
+			size_t h = 2166136261u;
+			for (unsigned int i = 0; i < stride * sizeof(float); ++i) h = (h ^ bytes[i]) * 16777619u;
+			return h;
+		};
+		auto equal = [base, stride](unsigned int a, unsigned int b) {
+			return std::memcmp(base + a * stride, base + b * stride, stride * sizeof(float)) == 0;
+		};
+		std::unordered_map<unsigned int, unsigned int, decltype(hash), decltype(equal)> unique(vertexCount, hash, equal);
+
+		Vertices.clear();
+		Indices.resize(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; ++v) {
+			auto it = unique.emplace(v, vertexNum());
+			if (it.second)
+				Vertices.insert(Vertices.end(), base + v * stride, base + (v + 1) * stride);
+			Indices[v] = it.first->second;
+		}
+	}
+
+	// create buffers and link vertex attributes following Layout
+	void setupMesh(const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount) {
+		VertexCount = vertexCount;
+		IndexCount = indexCount;
+		GLResources &resources = GLResources::get();
+		VertexArray = resources.createVertexArray();
+		VertexBuffer = resources.createBuffer();
+		ElementBuffer = resources.createBuffer();
+		VAO = resources.name(VertexArray);
+		VBO = resources.name(VertexBuffer);
+		EBO = resources.name(ElementBuffer);
+
+		GLState::get().bindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, (size_t)vertexCount * Stride * sizeof(float), vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+		resources.setMemory(VertexBuffer, (size_t)vertexCount * Stride * sizeof(float));
+		resources.setMemory(ElementBuffer, (size_t)indexCount * sizeof(unsigned int));
+
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < Layout.size(); ++i) {
+			glEnableVertexAttribArray(i);
+			glVertexAttribPointer(i, Layout[i], GL_FLOAT, GL_FALSE, Stride * sizeof(float), (void*)(offset * sizeof(float)));
+			offset += Layout[i];
+		}
+		// later element buffer binds must not end up in this VAO
+		GLState::get().bindVertexArray(0);
+	}
+
+	// Forsyth's vertex score: recently used vertices and vertices with few
+	// remaining triangles are preferred
+	static float score(int cachePosition, unsigned int remainingTriangles, unsigned int cacheSize) {
+		if (remainingTriangles == 0) return -1.0f;
+		float result = 0.0f;
+		if (cachePosition >= 0) {
+			// the last triangle's vertices get a fixed score so the next triangle
+			// doesn't prefer reusing exactly them over its neighbours
+			if (cachePosition < 3)
+				result = 0.75f;
+			else
+				result = std::pow(1.0f - (float)(cachePosition - 3) / (cacheSize - 3), 1.5f);
+		}
+		// boost vertices with few triangles left so they get finished off
+		result += 2.0f / std::sqrt((float)remainingTriangles);
+		return result;
+	}
+
+	static int bestTriangle(const std::vector<float> &triangleScore) {
+		int best = -1;
+		float bestScore = -1e30f;
+		for (unsigned int t = 0; t < triangleScore.size(); ++t) {
+			if (triangleScore[t] > bestScore) {
+				bestScore = triangleScore[t];
+				best = (int)t;
+			}
+		}
+		return best;
+	}
+};
+
+#endif // !MESH_H
@@ -0,0 +1,94 @@
+// anim_bench: measures batch evaluation of many keyframed transform tracks.
+//
+// usage: anim_bench [tracks] [keys] [threads]
+// Builds `tracks` random TRS tracks (100000 by default) of `keys` keys each
+// (32 by default, at least 2; hermite translation, slerp rotation, linear
+// scale) and samples all of them once per simulated 60 Hz frame, then again at
+// random times where the segment cache cannot help and every curve falls back
+// to a binary search. Finally
+// the tracks are split into one range per thread (all hardware threads by
+// default) and sampled in parallel with sampleRange().
+
+#include "../src/animation.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+const float        CLIP_DURATION = 10.0f;
+const unsigned int FRAME_NUM     = 300;
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	unsigned int trackNum = argc > 1 ? (unsigned int)std::atoi(argv[1]) : 100000;
+	// at least two keys, the key times are spread over the clip
+	unsigned int keyNum = argc > 2 ? std::max(2u, (unsigned int)std::atoi(argv[2])) : 32;
+	unsigned int threadNum = argc > 3 ? (unsigned int)std::atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	AnimationClip clip(CLIP_DURATION);
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < trackNum; ++i) {
+		std::vector<float> times;
+		std::vector<glm::vec3> positions, scales;
+		std::vector<glm::quat> rotations;
+		glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + 0.1f);
+		for (unsigned int k = 0; k < keyNum; ++k) {
+			times.push_back(CLIP_DURATION * k / (keyNum - 1));
+			positions.push_back(glm::vec3(unit(random), unit(random), unit(random)) * 10.0f);
+			scales.push_back(glm::vec3(0.5f + unit(random)));
+			rotations.push_back(glm::angleAxis(k * 1.5f, axis));
+		}
+		TransformTrack track;
+		track.Translation = clip.addCurve(times, positions, HERMITE);
+		track.Rotation = clip.addCurve(times, rotations, LINEAR);
+		track.Scale = clip.addCurve(times, scales, LINEAR);
+		clip.addTrack(track);
+	}
+	std::cout << trackNum << " tracks of " << keyNum << " keys built in " << elapsed(start) << " ms, "
+		<< (clip.Times.size() * sizeof(float) + clip.Vectors.size() * sizeof(glm::vec3) + clip.Rotations.size() * sizeof(glm::quat)
+			+ clip.Arcs.size() * sizeof(glm::vec2)) / (1024.0 * 1024.0)
+		<< " MB of keys" << std::endl;
+
+	std::vector<glm::mat4> transforms(trackNum);
+	start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < FRAME_NUM; ++frame)
+		clip.sampleAll(frame / 60.0f, transforms.data());
+	double sequential = elapsed(start) / FRAME_NUM;
+	std::cout << "sequential: " << sequential << " ms per frame, " << sequential * 1.0e6 / trackNum << " ns per track" << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < FRAME_NUM; ++frame)
+		clip.sampleAll(unit(random) * CLIP_DURATION, transforms.data());
+	double jumping = elapsed(start) / FRAME_NUM;
+	std::cout << "random times: " << jumping << " ms per frame, " << jumping * 1.0e6 / trackNum << " ns per track" << std::endl;
+
+	// the calling thread samples the first range
+	unsigned int rangeSize = (trackNum + threadNum - 1) / threadNum;
+	start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < FRAME_NUM; ++frame) {
+		float time = frame / 60.0f;
+		std::vector<std::thread> workers;
+		for (unsigned int first = rangeSize; first < trackNum; first += rangeSize) {
+			unsigned int count = std::min(rangeSize, trackNum - first);
+			workers.emplace_back([&clip, &transforms, first, count, time] { clip.sampleRange(first, count, time, transforms.data() + first); });
+		}
+		clip.sampleRange(0, std::min(rangeSize, trackNum), time, transforms.data());
+		for (std::thread &worker : workers) worker.join();
+	}
+	double parallel = elapsed(start) / FRAME_NUM;
+	std::cout << threadNum << " threads: " << parallel << " ms per frame, " << sequential / parallel << "x" << std::endl;
+
+	// keep the results alive
+	float checksum = 0.0f;
+	for (const glm::mat4 &m : transforms) checksum += m[3][0];
+	std::cout << "checksum " << checksum << std::endl;
+	return 0;
+}
@@ -0,0 +1,429 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define BVH_USE_SSE
+#endif
+
+// Default BVH options
+const unsigned int BVH_BINS           = 16;   // SAH candidates per axis
+const unsigned int BVH_MAX_LEAF_SIZE  = 8;    // a leaf is forced to split above this size
+const float        BVH_TRAVERSAL_COST = 1.0f; // cost of a node visit relative to a primitive test
+const unsigned int BVH_STACK_SIZE     = 128;  // pending far children kept on the stack, deeper trees spill to the heap
+
+// Axis aligned bounding box
+struct AABB {
+	glm::vec3 Min, Max;
+
+	AABB() : Min(FLT_MAX), Max(-FLT_MAX) {}
+	AABB(const glm::vec3 &min, const glm::vec3 &max) : Min(min), Max(max) {}
+
+	void grow(const glm::vec3 &p) { Min = glm::min(Min, p); Max = glm::max(Max, p); }
+	void grow(const AABB &b) { Min = glm::min(Min, b.Min); Max = glm::max(Max, b.Max); }
+	glm::vec3 center() const { return (Min + Max) * 0.5f; }
+	// half of the surface area, enough for SAH ratios
+	float area() const {
+		glm::vec3 e = Max - Min;
+		return e.x < 0.0f ? 0.0f : e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	// box of the 8 corners of `box` transformed by `m`
+	static AABB transform(const AABB &box, const glm::mat4 &m) {
+		AABB result;
+		for (int i = 0; i < 8; ++i) {
+			glm::vec3 corner(i & 1 ? box.Max.x : box.Min.x, i & 2 ? box.Max.y : box.Min.y, i & 4 ? box.Max.z : box.Min.z);
+			result.grow(glm::vec3(m * glm::vec4(corner, 1.0f)));
+		}
+		return result;
+	}
+};
+
+// Ray with a parameter range [0, TMax). Direction does not need to be
+// normalized, t is then measured in multiples of it.
+struct Ray {
+	glm::vec3 Origin, Direction, InvDirection;
+	float TMax;
+
+	Ray(const glm::vec3 &origin, const glm::vec3 &direction, float tMax = FLT_MAX) :
+		Origin(origin), Direction(direction), TMax(tMax)
+	{
+		// avoid infinities times zero in the slab test
+		InvDirection = glm::vec3(1.0f / safe(direction.x), 1.0f / safe(direction.y), 1.0f / safe(direction.z));
+	}
+
+	glm::vec3 at(float t) const { return Origin + Direction * t; }
+
+	// same ray in the space of a model matrix, t values stay comparable
+	Ray toModel(const glm::mat4 &inverseModel) const {
+		return Ray(glm::vec3(inverseModel * glm::vec4(Origin, 1.0f)), glm::vec3(inverseModel * glm::vec4(Direction, 0.0f)), TMax);
+	}
+
+private:
+	static float safe(float d) { return std::fabs(d) < 1e-20f ? (d < 0.0f ? -1e-20f : 1e-20f) : d; }
+};
+
+struct RayHit {
+	float T;
+	unsigned int Primitive;
+	// barycentric coordinates of the hit on a triangle
+	float U, V;
+
+	RayHit() : T(FLT_MAX), Primitive(0), U(0.0f), V(0.0f) {}
+	bool hit() const { return T < FLT_MAX; }
+};
+
+// Bounding volume hierarchy over arbitrary primitives given by their boxes,
+// built with the binned surface area heuristic. Nodes are stored depth first
+// in one array; the children of an inner node are always adjacent.
+class BVH {
+public:
+	// 32 bytes, two nodes per cache line
+	struct Node {
+		float Min[3];
+		unsigned int LeftFirst; // left child for inner nodes, first primitive for leaves
+		float Max[3];
+		unsigned int Count;     // 0 for inner nodes
+		bool leaf() const { return Count != 0; }
+	};
+
+	std::vector<Node> Nodes;
+	// primitive ids in leaf order
+	std::vector<unsigned int> Primitives;
+	double BuildTime; // milliseconds
+
+	BVH() : BuildTime(0.0) {}
+
+	explicit BVH(const std::vector<AABB> &boxes) : BuildTime(0.0) {
+		auto start = std::chrono::steady_clock::now();
+		build(boxes);
+		BuildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	AABB bounds() const {
+		if (Nodes.empty()) return AABB();
+		return AABB(glm::vec3(Nodes[0].Min[0], Nodes[0].Min[1], Nodes[0].Min[2]), glm::vec3(Nodes[0].Max[0], Nodes[0].Max[1], Nodes[0].Max[2]));
+	}
+
+	// Closest hit. `test(primitive, ray, tMax)` intersects one primitive and
+	// returns true after lowering tMax to a closer hit.
+	template <class Test>
+	bool intersect(const Ray &ray, float &tMax, Test test) const {
+		return traverse<false>(ray, tMax, test);
+	}
+
+	// Any hit in [0, ray.TMax), for shadow and line of sight rays
+	template <class Test>
+	bool occluded(const Ray &ray, Test test) const {
+		float tMax = ray.TMax;
+		return traverse<true>(ray, tMax, test);
+	}
+
+	// number of nodes visited by the last query on this thread, for benchmarks
+	static unsigned int &visited() {
+		static thread_local unsigned int count = 0;
+		return count;
+	}
+
+private:
+	struct Bin {
+		AABB Bounds;
+		unsigned int Count = 0;
+	};
+
+	void build(const std::vector<AABB> &boxes) {
+		unsigned int count = (unsigned int)boxes.size();
+		Primitives.resize(count);
+		for (unsigned int i = 0; i < count; ++i) Primitives[i] = i;
+		Nodes.clear();
+		if (count == 0) return;
+		Nodes.reserve(2 * (size_t)count);
+
+		std::vector<glm::vec3> centers(count);
+		for (unsigned int i = 0; i < count; ++i) centers[i] = boxes[i].center();
+
+		Nodes.push_back(Node());
+		struct Task { unsigned int Node, First, Count; };
+		std::vector<Task> tasks(1, Task{ 0, 0, count });
+		while (!tasks.empty()) {
+			Task task = tasks.back();
+			tasks.pop_back();
+
+			AABB bounds, centerBounds;
+			for (unsigned int i = task.First; i < task.First + task.Count; ++i) {
+				bounds.grow(boxes[Primitives[i]]);
+				centerBounds.grow(centers[Primitives[i]]);
+			}
+			setBounds(Nodes[task.Node], bounds);
+
+			unsigned int split = findSplit(boxes, centers, task.First, task.Count, bounds, centerBounds);
+			if (split == 0) {
+				Nodes[task.Node].LeftFirst = task.First;
+				Nodes[task.Node].Count = task.Count;
+				continue;
+			}
+
+			unsigned int left = (unsigned int)Nodes.size();
+			Nodes.push_back(Node());
+			Nodes.push_back(Node());
+			Nodes[task.Node].LeftFirst = left;
+			Nodes[task.Node].Count = 0;
+			tasks.push_back(Task{ left + 1, task.First + split, task.Count - split });
+			tasks.push_back(Task{ left, task.First, split });
+		}
+	}
+
+	// Partitions the range along the cheapest SAH plane and returns the size of
+	// the left part, or 0 if a leaf is cheaper
+	unsigned int findSplit(const std::vector<AABB> &boxes, const std::vector<glm::vec3> &centers,
+		unsigned int first, unsigned int count, const AABB &bounds, const AABB &centerBounds) {
+		if (count <= 1) return 0;
+
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		unsigned int bestBin = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			float lo = centerBounds.Min[axis], extent = centerBounds.Max[axis] - lo;
+			if (extent <= 0.0f) continue;
+			float scale = BVH_BINS / extent;
+
+			Bin bins[BVH_BINS];
+			for (unsigned int i = first; i < first + count; ++i) {
+				unsigned int b = std::min(BVH_BINS - 1, (unsigned int)((centers[Primitives[i]][axis] - lo) * scale));
+				bins[b].Bounds.grow(boxes[Primitives[i]]);
+				++bins[b].Count;
+			}
+
+			// sweep from the right, then evaluate every plane from the left
+			float rightArea[BVH_BINS];
+			unsigned int rightCount[BVH_BINS];
+			AABB right;
+			unsigned int rightSum = 0;
+			for (unsigned int b = BVH_BINS - 1; b > 0; --b) {
+				right.grow(bins[b].Bounds);
+				rightSum += bins[b].Count;
+				rightArea[b] = right.area();
+				rightCount[b] = rightSum;
+			}
+			AABB left;
+			unsigned int leftSum = 0;
+			for (unsigned int b = 0; b + 1 < BVH_BINS; ++b) {
+				left.grow(bins[b].Bounds);
+				leftSum += bins[b].Count;
+				if (leftSum == 0 || rightCount[b + 1] == 0) continue;
+				float cost = left.area() * leftSum + rightArea[b + 1] * rightCount[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b + 1;
+				}
+			}
+		}
+
+		float leafCost = bounds.area() * count;
+		float splitCost = BVH_TRAVERSAL_COST * bounds.area() + bestCost;
+		if (bestAxis < 0) {
+			// all centers coincide, only split oversized leaves at the middle
+			return count > BVH_MAX_LEAF_SIZE ? count / 2 : 0;
+		}
+		if (splitCost >= leafCost && count <= BVH_MAX_LEAF_SIZE) return 0;
+
+		float lo = centerBounds.Min[bestAxis];
+		float scale = BVH_BINS / (centerBounds.Max[bestAxis] - lo);
+		unsigned int* begin = &Primitives[first];
+		unsigned int* middle = std::partition(begin, begin + count, [&](unsigned int p) {
+			return std::min(BVH_BINS - 1, (unsigned int)((centers[p][bestAxis] - lo) * scale)) < bestBin;
+		});
+		return (unsigned int)(middle - begin);
+	}
+
+	static void setBounds(Node &node, const AABB &box) {
+		for (int k = 0; k < 3; ++k) {
+			node.Min[k] = box.Min[k];
+			node.Max[k] = box.Max[k];
+		}
+	}
+
+	// Slab test, returns the entry distance or FLT_MAX on a miss
+#ifdef BVH_USE_SSE
+	static float hitBox(const Node &node, const __m128 &origin, const __m128 &invDirection, float tMax) {
+		// the fourth lane holds LeftFirst/Count and is ignored below
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.Min), origin), invDirection);
+		__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.Max), origin), invDirection);
+		__m128 near4 = _mm_min_ps(t1, t2), far4 = _mm_max_ps(t1, t2);
+		__m128 tNear = _mm_max_ss(_mm_max_ss(near4, _mm_shuffle_ps(near4, near4, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(near4, near4, _MM_SHUFFLE(2, 2, 2, 2)));
+		__m128 tFar = _mm_min_ss(_mm_min_ss(far4, _mm_shuffle_ps(far4, far4, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(far4, far4, _MM_SHUFFLE(2, 2, 2, 2)));
+		tNear = _mm_max_ss(tNear, _mm_setzero_ps());
+		tFar = _mm_min_ss(tFar, _mm_set_ss(tMax));
+		float enter = _mm_cvtss_f32(tNear);
+		return enter <= _mm_cvtss_f32(tFar) ? enter : FLT_MAX;
+	}
+#else
+	static float hitBox(const Node &node, const glm::vec3 &origin, const glm::vec3 &invDirection, float tMax) {
+		float tNear = 0.0f, tFar = tMax;
+		for (int k = 0; k < 3; ++k) {
+			float t1 = (node.Min[k] - origin[k]) * invDirection[k];
+			float t2 = (node.Max[k] - origin[k]) * invDirection[k];
+			tNear = std::max(tNear, std::min(t1, t2));
+			tFar = std::min(tFar, std::max(t1, t2));
+		}
+		return tNear <= tFar ? tNear : FLT_MAX;
+	}
+#endif
+
+	template <bool AnyHit, class Test>
+	bool traverse(const Ray &ray, float &tMax, Test &test) const {
+		if (Nodes.empty()) return false;
+#ifdef BVH_USE_SSE
+		__m128 origin = _mm_setr_ps(ray.Origin.x, ray.Origin.y, ray.Origin.z, 0.0f);
+		__m128 invDirection = _mm_setr_ps(ray.InvDirection.x, ray.InvDirection.y, ray.InvDirection.z, 0.0f);
+#else
+		const glm::vec3 &origin = ray.Origin, &invDirection = ray.InvDirection;
+#endif
+		unsigned int &visits = visited();
+		visits = 0;
+		if (hitBox(Nodes[0], origin, invDirection, tMax) == FLT_MAX) return false;
+
+		unsigned int stack[BVH_STACK_SIZE];
+		// far children beyond BVH_STACK_SIZE, only allocated for degenerate trees
+		std::vector<unsigned int> overflow;
+		unsigned int top = 0, current = 0;
+		bool found = false;
+		while (true) {
+			const Node &node = Nodes[current];
+			++visits;
+			if (node.leaf()) {
+				for (unsigned int i = node.LeftFirst; i < node.LeftFirst + node.Count; ++i) {
+					if (test(Primitives[i], ray, tMax)) {
+						found = true;
+						if (AnyHit) return true;
+					}
+				}
+			}
+			else {
+				// visit the nearer child first, keep the other one for later
+				unsigned int near = node.LeftFirst, far = node.LeftFirst + 1;
+				float tNear = hitBox(Nodes[near], origin, invDirection, tMax);
+				float tFar = hitBox(Nodes[far], origin, invDirection, tMax);
+				if (tFar < tNear) {
+					std::swap(near, far);
+					std::swap(tNear, tFar);
+				}
+				if (tNear != FLT_MAX) {
+					if (tFar != FLT_MAX) {
+						if (top < BVH_STACK_SIZE) stack[top++] = far;
+						else overflow.push_back(far);
+					}
+					current = near;
+					continue;
+				}
+			}
+			if (!overflow.empty()) {
+				current = overflow.back();
+				overflow.pop_back();
+				continue;
+			}
+			if (top == 0) break;
+			current = stack[--top];
+		}
+		return found;
+	}
+};
+
+// BVH over the triangles of an indexed mesh. Triangle corners are copied in
+// leaf order so a leaf reads one contiguous block of memory.
+class TriangleBVH {
+public:
+	BVH Tree;
+	// three corners per triangle in leaf order, Tree.Primitives is the identity
+	std::vector<glm::vec3> Corners;
+	// leaf order -> triangle index of the mesh
+	std::vector<unsigned int> Triangles;
+
+	TriangleBVH() {}
+
+	// `vertices` holds `stride` floats per vertex, the position first
+	TriangleBVH(const float* vertices, unsigned int stride, const unsigned int* indices, size_t indexCount) {
+		size_t triangleCount = indexCount / 3;
+		std::vector<AABB> boxes(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+			for (int k = 0; k < 3; ++k)
+				boxes[t].grow(position(vertices, stride, indices[t * 3 + k]));
+
+		Tree = BVH(boxes);
+
+		Triangles.swap(Tree.Primitives);
+		Tree.Primitives.resize(triangleCount);
+		Corners.resize(triangleCount * 3);
+		for (size_t i = 0; i < triangleCount; ++i) {
+			Tree.Primitives[i] = (unsigned int)i;
+			for (int k = 0; k < 3; ++k)
+				Corners[i * 3 + k] = position(vertices, stride, indices[Triangles[i] * 3 + k]);
+		}
+	}
+
+	// closest triangle along the ray, hit.Primitive is the triangle index of the mesh
+	bool intersect(const Ray &ray, RayHit &hit) const {
+		float tMax = std::min(ray.TMax, hit.T);
+		unsigned int slot = 0;
+		float u = 0.0f, v = 0.0f;
+		bool found = Tree.intersect(ray, tMax, [&](unsigned int i, const Ray &r, float &t) {
+			if (!hitTriangle(r, Corners[i * 3], Corners[i * 3 + 1], Corners[i * 3 + 2], t, u, v)) return false;
+			slot = i;
+			return true;
+		});
+		if (found) {
+			hit.T = tMax;
+			hit.Primitive = Triangles[slot];
+			hit.U = u;
+			hit.V = v;
+		}
+		return found;
+	}
+
+	// true if something blocks the segment between two points
+	bool occluded(const glm::vec3 &from, const glm::vec3 &to) const {
+		Ray ray(from, to - from, 1.0f - 1e-4f);
+		return Tree.occluded(ray, [&](unsigned int i, const Ray &r, float &t) {
+			float u, v;
+			return hitTriangle(r, Corners[i * 3], Corners[i * 3 + 1], Corners[i * 3 + 2], t, u, v);
+		});
+	}
+
+	// Möller-Trumbore intersection of one triangle
+	static bool hitTriangle(const Ray &ray, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, float &tMax, float &u, float &v) {
+		glm::vec3 e1 = b - a, e2 = c - a;
+		glm::vec3 p = glm::cross(ray.Direction, e2);
+		float det = glm::dot(e1, p);
+		if (std::fabs(det) < 1e-12f) return false;
+		float inv = 1.0f / det;
+		glm::vec3 s = ray.Origin - a;
+		float bu = glm::dot(s, p) * inv;
+		if (bu < 0.0f || bu > 1.0f) return false;
+		glm::vec3 q = glm::cross(s, e1);
+		float bv = glm::dot(ray.Direction, q) * inv;
+		if (bv < 0.0f || bu + bv > 1.0f) return false;
+		float t = glm::dot(e2, q) * inv;
+		if (t <= 0.0f || t >= tMax) return false;
+		tMax = t;
+		u = bu;
+		v = bv;
+		return true;
+	}
+
+private:
+	static glm::vec3 position(const float* vertices, unsigned int stride, unsigned int index) {
+		const float* p = vertices + (size_t)index * stride;
+		return glm::vec3(p[0], p[1], p[2]);
+	}
+};
+
+#endif // !BVH_H
@@ -0,0 +1,62 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// Result of a culling test
+enum Frustum_Test {
+	OUTSIDE,
+	INTERSECT,
+	INSIDE
+};
+
+// View frustum as six inward facing planes, extracted from a projection *
+// view matrix (Gribb & Hartmann)
+class Frustum {
+public:
+	// left, right, bottom, top, near, far; xyz is the normal, w the offset
+	glm::vec4 Planes[6];
+
+	Frustum() {}
+
+	explicit Frustum(const glm::mat4 &viewProjection) {
+		// rows of the column major matrix
+		glm::vec4 row[4];
+		for (int i = 0; i < 4; ++i)
+			row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		Planes[0] = row[3] + row[0];
+		Planes[1] = row[3] - row[0];
+		Planes[2] = row[3] + row[1];
+		Planes[3] = row[3] - row[1];
+		Planes[4] = row[3] + row[2];
+		Planes[5] = row[3] - row[2];
+		for (glm::vec4 &plane : Planes)
+			plane = plane / glm::length(glm::vec3(plane));
+	}
+
+	Frustum_Test testSphere(const glm::vec3 &center, float radius) const {
+		Frustum_Test result = INSIDE;
+		for (const glm::vec4 &plane : Planes) {
+			float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+			if (distance < -radius) return OUTSIDE;
+			if (distance < radius) result = INTERSECT;
+		}
+		return result;
+	}
+
+	Frustum_Test testBox(const glm::vec3 &min, const glm::vec3 &max) const {
+		Frustum_Test result = INSIDE;
+		for (const glm::vec4 &plane : Planes) {
+			// corners furthest along and against the normal
+			glm::vec3 positive(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+			glm::vec3 negative(plane.x >= 0.0f ? min.x : max.x, plane.y >= 0.0f ? min.y : max.y, plane.z >= 0.0f ? min.z : max.z);
+			if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) return OUTSIDE;
+			if (glm::dot(glm::vec3(plane), negative) + plane.w < 0.0f) result = INTERSECT;
+		}
+		return result;
+	}
+};
+
+#endif // !FRUSTUM_H
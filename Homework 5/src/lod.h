@@ -0,0 +1,137 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <iostream>
+
+#include "mesh.h"
+#include "simplify.h"
+#include "gl_resources.h"
+
+// Default LOD options
+const unsigned int LOD_MAX_LEVELS  = 6;
+const float        LOD_REDUCTION   = 0.25f; // triangle ratio between two levels
+const float        LOD_MIN_SAVING  = 0.8f;  // stop once a level keeps more than this ratio of its parent
+const float        LOD_PIXEL_ERROR = 1.0f;  // largest allowed error on screen, in pixels
+
+// A mesh with a precomputed chain of simplified index buffers. All levels index
+// the vertex buffer of the original mesh and live one after another in its
+// element buffer, so switching level is only a different range in draw().
+class LodMesh {
+public:
+	struct Level {
+		unsigned int Offset; // first index in the element buffer
+		unsigned int Count;  // number of indices
+		float Error;         // geometric error in model space units
+	};
+
+	// GL buffers, Base.draw() still renders the full detail level
+	Mesh Base;
+	std::vector<Level> Levels;
+	// bounding sphere in model space
+	glm::vec3 Center;
+	float Radius;
+
+	LodMesh() : Center(0.0f), Radius(0.0f) {}
+
+	// Builds the chain from a mesh that kept its CPU copy (Vertices/Indices)
+	LodMesh(const Mesh &mesh, unsigned int maxLevels = LOD_MAX_LEVELS) : Base(mesh), Center(0.0f), Radius(0.0f) {
+		computeBounds();
+
+		std::vector<unsigned int> all(Base.Indices);
+		Levels.push_back({ 0, (unsigned int)Base.Indices.size(), 0.0f });
+
+		Simplifier simplifier(Base.Vertices.data(), Base.vertexNum(), Base.Stride, Base.Indices);
+		while (Levels.size() < maxLevels) {
+			size_t previous = Levels.back().Count;
+			simplifier.simplify((size_t)(previous * LOD_REDUCTION) / 3 * 3);
+			if (simplifier.Indices.empty() || simplifier.Indices.size() > previous * LOD_MIN_SAVING) break;
+
+			std::vector<unsigned int> level(simplifier.Indices);
+			Mesh::optimizeVertexCache(level, Base.vertexNum());
+			Levels.push_back({ (unsigned int)all.size(), (unsigned int)level.size(), simplifier.Error });
+			all.insert(all.end(), level.begin(), level.end());
+		}
+
+		// replace the element buffer by the concatenated levels
+		GLState::get().bindVertexArray(Base.VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Base.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, all.size() * sizeof(unsigned int), all.data(), GL_STATIC_DRAW);
+		GLResources::get().setMemory(Base.ElementBuffer, all.size() * sizeof(unsigned int));
+		GLState::get().bindVertexArray(0);
+	}
+
+	// Picks the coarsest level whose error, projected at `distance` through a
+	// perspective camera with a vertical field of view of `fov` degrees (e.g.
+	// camera.Zoom), covers at most `pixelError` pixels. `scale` is the uniform
+	// scale of the model matrix.
+	unsigned int selectLevel(float distance, float fov, float screenHeight, float scale = 1.0f, float pixelError = LOD_PIXEL_ERROR) const {
+		if (distance <= 0.0f) return 0;
+		float pixelsPerUnit = screenHeight / (2.0f * distance * std::tan(glm::radians(fov) * 0.5f));
+		unsigned int level = 0;
+		while (level + 1 < Levels.size() && Levels[level + 1].Error * scale * pixelsPerUnit <= pixelError)
+			++level;
+		return level;
+	}
+
+	// Distance from `eye` to the bounding sphere of an instance placed at
+	// `position` with uniform `scale`, 0 inside the sphere
+	float distanceTo(const glm::vec3 &eye, const glm::vec3 &position, float scale = 1.0f) const {
+		return std::fmax(glm::length(eye - (position + Center * scale)) - Radius * scale, 0.0f);
+	}
+
+	unsigned int triangleNum(unsigned int level) const {
+		return Levels[level].Count / 3;
+	}
+
+	// render one level of the mesh
+	void draw(unsigned int level) const {
+		GLState::get().bindVertexArray(Base.VAO);
+		glDrawElements(GL_TRIANGLES, (GLsizei)Levels[level].Count, GL_UNSIGNED_INT, (void*)(Levels[level].Offset * sizeof(unsigned int)));
+	}
+
+	// render several instances of one level in one call
+	void drawInstanced(unsigned int level, unsigned int instanceCount) const {
+		GLState::get().bindVertexArray(Base.VAO);
+		glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)Levels[level].Count, GL_UNSIGNED_INT,
+			(void*)(Levels[level].Offset * sizeof(unsigned int)), (GLsizei)instanceCount);
+	}
+
+	// prints triangle count and error of every level
+	void printStats(const std::string &name) const {
+		std::cout << "LOD::" << name << ":";
+		for (size_t i = 0; i < Levels.size(); ++i)
+			std::cout << (i ? " ->" : "") << " " << Levels[i].Count / 3 << " (" << Levels[i].Error << ")";
+		std::cout << " triangles (error)" << std::endl;
+	}
+
+	// de-allocate GL objects, must be called while the context is alive
+	void release() {
+		Base.release();
+		Levels.clear();
+	}
+
+private:
+	void computeBounds() {
+		unsigned int vertexCount = Base.vertexNum();
+		if (vertexCount == 0) return;
+		glm::vec3 lo(Base.Vertices[0], Base.Vertices[1], Base.Vertices[2]), hi = lo;
+		for (unsigned int v = 0; v < vertexCount; ++v) {
+			const float* p = &Base.Vertices[(size_t)v * Base.Stride];
+			lo = glm::min(lo, glm::vec3(p[0], p[1], p[2]));
+			hi = glm::max(hi, glm::vec3(p[0], p[1], p[2]));
+		}
+		Center = (lo + hi) * 0.5f;
+		for (unsigned int v = 0; v < vertexCount; ++v) {
+			const float* p = &Base.Vertices[(size_t)v * Base.Stride];
+			Radius = std::fmax(Radius, glm::length(glm::vec3(p[0], p[1], p[2]) - Center));
+		}
+	}
+};
+
+#endif // !LOD_H
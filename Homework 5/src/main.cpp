@@ -11,13 +11,26 @@
 
 #include "camera.h"
 #include "shader.h"
+#include "mesh.h"
+#include "gl_state.h"
+#include "gl_resources.h"
+#include "lod.h"
+#include "bvh.h"
+#include "octree.h"
+#include "multiview.h"
+#include "timestep.h"
+#include "headless.h"
+#include "frame_capture.h"
 
 #include <iostream>
+#include <vector>
+#include <random>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+Mesh buildSphere(float radius, unsigned int rings, unsigned int sectors);
 
 // default setting
 const unsigned int WIDTH = 800;
@@ -25,6 +38,28 @@ const unsigned int HEIGHT = 600;
 
 const char* glsl_version = "#version 330 core";
 
+// row of detailed spheres the FPS camera can fly away from
+const unsigned int SPHERE_NUM     = 8;
+const float        SPHERE_SPACING = 12.0f;
+
+// small cubes orbiting the spheres, culled through a loose octree
+const unsigned int ASTEROID_NUM    = 2000;
+const float        ASTEROID_SCALE  = 0.15f;
+const float        ASTEROID_RADIUS = 2.0f * 1.7320508f * ASTEROID_SCALE; // bounding sphere of the scaled cube
+const glm::vec3    ASTEROID_CENTER(0.0f, 0.0f, -40.0f);
+
+struct Asteroid {
+	float Orbit, Height, Phase, Speed;
+	unsigned int Id; // object id in the octree
+};
+
+// one object of the split screen draw list
+struct SplitDraw {
+	glm::mat4 Model;
+	int Level;         // LOD level of the sphere, -1 for a cube
+	unsigned int Mask; // bit i is set if the object is visible in view i
+};
+
 // Global camera
 Camera camera(glm::vec3(0.0f, 0.0f, 10.0f));
 float
@@ -36,12 +71,14 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main() {
+int main(int argc, char* argv[]) {
 	//----------------------------------------------------------------
 	// Initialize and configure GLFW
 	// Version: 3.3
 	// Profile: CORE
-	glfwInit();
+	// --headless renders offscreen without a display, see headless.h
+	Headless headless(argc, argv, WIDTH, HEIGHT);
+	headless.init();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -49,7 +86,7 @@ int main() {
 	// Create GLFW window
 	// Width:  800
 	// Height: 600
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "HW5", NULL, NULL);
+	GLFWwindow* window = headless.createWindow(WIDTH, HEIGHT, "HW5");
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window." << std::endl;
 		glfwTerminate();
@@ -66,6 +103,19 @@ int main() {
 		return -1;
 	}
 
+	// every GL object lives in pools that count it, deleted ones are dropped
+	// from the state cache
+	GLResources &resources = GLResources::get();
+	resources.OnDelete = [](GLResourceType type, GLuint name) { GLState::get().forget(type, name); };
+
+	// offscreen framebuffer of the headless mode
+	if (!headless.setup()) {
+		glfwTerminate();
+		return -1;
+	}
+	// --capture DIR writes every frame to DIR, see frame_capture.h
+	FrameCapture capture(headless.Arguments, headless.width(), headless.height());
+
 	// Setup ImGui Context
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -84,6 +134,10 @@ int main() {
 
 	// build and compile shader program
 	Shader shader("shader.vs", "shader.fs");
+	// same shader drawing into several viewport tiles at once
+	Shader multiviewShader("multiview.vs", "shader.fs");
+	MultiView multiview;
+	multiview.bind(multiviewShader);
 
 	// vertex data
 	float vertices[] = {
@@ -130,23 +184,67 @@ int main() {
 		-2.0f,  2.0f, -2.0f, 1.0f, 0.0f, 1.0f,
 	};
 
-	unsigned int VAO, VBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-
-	glBindVertexArray(VAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	// indexed cube, vertices are deduplicated and reordered for the vertex cache
+	Mesh cube(vertices, sizeof(vertices) / sizeof(float), { 3, 3 });
+	cube.printStats("cube");
+
+	// one sphere of 64k triangles with its simplified levels, shared by every instance
+	LodMesh sphere(buildSphere(2.0f, 128, 256));
+	sphere.printStats("sphere");
+	bool useLod = true;
+	float pixelError = LOD_PIXEL_ERROR;
+
+	// FPS scene: the cube followed by the spheres, with a BVH per mesh in model
+	// space and one over the objects in world space for camera ray picking
+	std::vector<glm::vec3> spherePositions;
+	std::vector<glm::mat4> objectModels(1, glm::rotate(glm::mat4(1.0f), glm::radians(45.0f), glm::vec3(1.0f, 0.0f, 1.0f)));
+	for (unsigned int i = 0; i < SPHERE_NUM; ++i) {
+		spherePositions.push_back(glm::vec3(6.0f, 0.0f, -(float)i * SPHERE_SPACING));
+		objectModels.push_back(glm::translate(glm::mat4(1.0f), spherePositions.back()));
+	}
+	TriangleBVH cubeBvh(cube.Vertices.data(), cube.Stride, cube.Indices.data(), cube.Indices.size());
+	TriangleBVH sphereBvh(sphere.Base.Vertices.data(), sphere.Base.Stride, sphere.Base.Indices.data(), sphere.Base.Indices.size());
+	std::vector<AABB> objectBoxes;
+	std::vector<glm::mat4> objectInverses;
+	for (unsigned int i = 0; i < objectModels.size(); ++i) {
+		objectBoxes.push_back(AABB::transform((i == 0 ? cubeBvh : sphereBvh).Tree.bounds(), objectModels[i]));
+		objectInverses.push_back(glm::inverse(objectModels[i]));
+	}
+	BVH objects(objectBoxes);
+	std::cout << "BVH::sphere: " << sphereBvh.Tree.Nodes.size() << " nodes built in " << sphereBvh.Tree.BuildTime << " ms" << std::endl;
+
+	// asteroids are moved every frame and only those in the camera frustum are drawn
+	LooseOctree octree(ASTEROID_CENTER, 128.0f);
+	std::vector<Asteroid> asteroids(ASTEROID_NUM);
+	std::vector<unsigned int> visible;
+
+	// split screen: one instanced pass for all views or one pass per view, with
+	// timings to compare both
+	bool singlePass = true;
+	std::vector<SplitDraw> splitDraws;
+	std::vector<unsigned int> asteroidMasks(ASTEROID_NUM);
+	unsigned int timerQueries[2];
+	bool timerIssued[2] = { false, false };
+	glGenQueries(2, timerQueries);
+	unsigned int frameIndex = 0, drawCalls = 0;
+	float cpuTime = 0.0f, gpuTime = 0.0f;
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (Asteroid &asteroid : asteroids) {
+		asteroid.Orbit  = 20.0f + 50.0f * unit(random);
+		asteroid.Height = 10.0f * (unit(random) - 0.5f);
+		asteroid.Phase  = glm::radians(360.0f * unit(random));
+		asteroid.Speed  = (0.5f + unit(random)) * 4.0f / asteroid.Orbit;
+		asteroid.Id = octree.insert(ASTEROID_CENTER, ASTEROID_RADIUS);
+	}
 
 	int type = 0;
+	// --split starts in the split screen, --separate-passes draws it one pass
+	// per view, so both modes can be measured headless, see tools/benchmark.cpp
+	for (const std::string &argument : headless.Arguments) {
+		if (argument == "--split") type = 5;
+		else if (argument == "--separate-passes") singlePass = false;
+	}
 
 	// Default Orthographic Projection options
 	// ---------------------------------------
@@ -165,13 +263,18 @@ int main() {
 		nearP2 =   0.1f,
 		farP2  = 100.0f;
 
+	// the orbiting view is driven by a fixed-step simulation clock
+	FixedTimestep timestep;
+
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(window)) {
+		headless.beginFrame();
 		// frame time
 		float current = glfwGetTime();
 		deltaTime = current - lastFrame;
 		lastFrame = current;
+		timestep.advance(current);
 
 		// input
 		processInput(window);
@@ -196,6 +299,7 @@ int main() {
 				if (ImGui::MenuItem("Persp")) { type = 2; }
 				if (ImGui::MenuItem("View"))  { type = 3; }
 				if (ImGui::MenuItem("FPS"))   { type = 4; }
+				if (ImGui::MenuItem("Split")) { type = 5; }
 				ImGui::EndMenu();
 			}
 			ImGui::EndMainMenuBar();
@@ -230,25 +334,204 @@ int main() {
 			ImGui::End();
 
 			view = glm::translate(view, glm::vec3(0.0f, 0.0f, -10.0f));
-			proj = glm::perspective(glm::radians(fov), (float)WIDTH / (float)HEIGHT, nearP2, farP2);
+			proj = glm::perspective(glm::radians(fov), (float)headless.width() / (float)headless.height(), nearP2, farP2);
 		}
 		// View Changing
 		// -------------
 		if (type == 3) {
 			float radius = 15.0f;
-			float camX = sin(glfwGetTime()) * radius;
-			float camZ = cos(glfwGetTime()) * radius;
+			float simTime = (float)timestep.renderTime();
+			float camX = sin(simTime) * radius;
+			float camZ = cos(simTime) * radius;
 			view = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			proj = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+			proj = glm::perspective(glm::radians(45.0f), (float)headless.width() / (float)headless.height(), 0.1f, 100.0f);
 		}
 		// FPS mode
 		// --------
 		if (type == 4) {
 			view = camera.getViewMatrix();
-			proj = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+			proj = glm::perspective(glm::radians(camera.Zoom), (float)headless.width() / (float)headless.height(), 0.1f, 100.0f);
+
+			shader.setMat4("view", view);
+			shader.setMat4("projection", proj);
+
+			// draw every sphere at the coarsest level that stays within pixelError
+			unsigned int drawn = 0, full = 0;
+			for (unsigned int i = 0; i < SPHERE_NUM; ++i) {
+				unsigned int level = 0;
+				if (useLod)
+					level = sphere.selectLevel(sphere.distanceTo(camera.Position, spherePositions[i]), camera.Zoom, (float)headless.height(), 1.0f, pixelError);
+				shader.setMat4("model", objectModels[i + 1]);
+				sphere.draw(level);
+				drawn += sphere.triangleNum(level);
+				full += sphere.triangleNum(0);
+			}
+
+			// move the asteroids, then draw the ones the octree finds in the frustum
+			float simTime = (float)timestep.renderTime();
+			for (const Asteroid &asteroid : asteroids) {
+				float angle = asteroid.Phase + asteroid.Speed * simTime;
+				glm::vec3 position = ASTEROID_CENTER + glm::vec3(cos(angle) * asteroid.Orbit, asteroid.Height, sin(angle) * asteroid.Orbit);
+				octree.move(asteroid.Id, position, ASTEROID_RADIUS);
+			}
+			visible.clear();
+			octree.queryFrustum(Frustum(proj * view), visible);
+			for (unsigned int id : visible) {
+				glm::mat4 asteroidModel = glm::translate(glm::mat4(1.0f), octree.Objects[id].Center);
+				shader.setMat4("model", glm::scale(asteroidModel, glm::vec3(ASTEROID_SCALE)));
+				cube.draw();
+			}
+
+			ImGui::Begin("Level of Detail");
+			ImGui::Checkbox("Enabled", &useLod);
+			ImGui::SliderFloat("Pixel error", &pixelError, 0.25f, 8.0f);
+			ImGui::Text("Sphere triangles: %u / %u", drawn, full);
+			ImGui::Text("Asteroids drawn: %u / %u, octree nodes %u", (unsigned int)visible.size(), ASTEROID_NUM, octree.nodeNum());
+			ImGui::End();
+
+			// pick the object in the middle of the screen
+			Ray ray(camera.Position, camera.Front);
+			RayHit hit;
+			int picked = -1;
+			float tMax = ray.TMax;
+			objects.intersect(ray, tMax, [&](unsigned int object, const Ray &r, float &t) {
+				RayHit local;
+				local.T = t;
+				if (!(object == 0 ? cubeBvh : sphereBvh).intersect(r.toModel(objectInverses[object]), local)) return false;
+				t = local.T;
+				hit = local;
+				picked = (int)object;
+				return true;
+			});
+
+			ImGui::Begin("Picking");
+			if (picked < 0)       ImGui::Text("Looking at: nothing");
+			else if (picked == 0) ImGui::Text("Looking at: cube");
+			else                  ImGui::Text("Looking at: sphere %d", picked - 1);
+			if (picked >= 0) ImGui::Text("Distance %.2f, triangle %u", hit.T, hit.Primitive);
+			ImGui::End();
 		}
 
-		if (type != 0) {
+		// Split screen
+		// ------------
+		if (type == 5) {
+			// top left orthographic, top right perspective, bottom left orbiting, bottom right FPS
+			float aspect = (float)headless.width() / (float)headless.height();
+			float simTime = (float)timestep.renderTime();
+			glm::vec3 orbitEye(sin(simTime) * 15.0f, 0.0f, cos(simTime) * 15.0f);
+			glm::mat4 backView = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f));
+			glm::mat4 viewProjections[MAX_VIEWS] = {
+				glm::ortho(left, right, bottom, top, nearP, farP) * backView,
+				glm::perspective(glm::radians(fov), aspect, nearP2, farP2) * backView,
+				glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f) * glm::lookAt(orbitEye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+				glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, 100.0f) * camera.getViewMatrix()
+			};
+			// eye and field of view for LOD selection, the orthographic view keeps full detail
+			glm::vec3 eyes[MAX_VIEWS] = { glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, 10.0f), orbitEye, camera.Position };
+			float fovs[MAX_VIEWS] = { 0.0f, fov, 45.0f, camera.Zoom };
+			// tiles of the framebuffer drawn to, the offscreen one when headless
+			float screenWidth = (float)headless.width(), screenHeight = (float)headless.height();
+			float tileX[MAX_VIEWS] = { 0.0f, screenWidth / 2.0f, 0.0f, screenWidth / 2.0f };
+			float tileY[MAX_VIEWS] = { screenHeight / 2.0f, screenHeight / 2.0f, 0.0f, 0.0f };
+			for (unsigned int v = 0; v < MAX_VIEWS; ++v)
+				multiview.setView(v, viewProjections[v], tileX[v], tileY[v], screenWidth / 2.0f, screenHeight / 2.0f, screenWidth, screenHeight);
+
+			for (const Asteroid &asteroid : asteroids) {
+				float angle = asteroid.Phase + asteroid.Speed * simTime;
+				glm::vec3 position = ASTEROID_CENTER + glm::vec3(cos(angle) * asteroid.Orbit, asteroid.Height, sin(angle) * asteroid.Orbit);
+				octree.move(asteroid.Id, position, ASTEROID_RADIUS);
+			}
+
+			// cull once per view and merge into one draw list, an object seen by
+			// several views is listed once with all their bits
+			unsigned int cubeMask = 0, sphereMasks[SPHERE_NUM] = { 0 };
+			std::fill(asteroidMasks.begin(), asteroidMasks.end(), 0u);
+			for (unsigned int v = 0; v < MAX_VIEWS; ++v) {
+				Frustum frustum(viewProjections[v]);
+				if (frustum.testSphere(glm::vec3(0.0f), 2.0f * 1.7320508f) != OUTSIDE) cubeMask |= 1u << v;
+				for (unsigned int i = 0; i < SPHERE_NUM; ++i)
+					if (frustum.testSphere(spherePositions[i] + sphere.Center, sphere.Radius) != OUTSIDE) sphereMasks[i] |= 1u << v;
+				visible.clear();
+				octree.queryFrustum(frustum, visible);
+				for (unsigned int id : visible) asteroidMasks[id] |= 1u << v;
+			}
+			splitDraws.clear();
+			if (cubeMask) splitDraws.push_back({ objectModels[0], -1, cubeMask });
+			for (unsigned int i = 0; i < SPHERE_NUM; ++i) {
+				if (!sphereMasks[i]) continue;
+				// the finest level any of the views needs
+				unsigned int level = (unsigned int)sphere.Levels.size() - 1;
+				for (unsigned int v = 0; v < MAX_VIEWS; ++v) {
+					if (!(sphereMasks[i] & (1u << v))) continue;
+					unsigned int needed = (fovs[v] == 0.0f || !useLod) ? 0 :
+						sphere.selectLevel(sphere.distanceTo(eyes[v], spherePositions[i]), fovs[v], screenHeight / 2.0f, 1.0f, pixelError);
+					level = std::min(level, needed);
+				}
+				splitDraws.push_back({ objectModels[i + 1], (int)level, sphereMasks[i] });
+			}
+			for (const Asteroid &asteroid : asteroids) {
+				if (!asteroidMasks[asteroid.Id]) continue;
+				glm::mat4 asteroidModel = glm::translate(glm::mat4(1.0f), octree.Objects[asteroid.Id].Center);
+				splitDraws.push_back({ glm::scale(asteroidModel, glm::vec3(ASTEROID_SCALE)), -1, asteroidMasks[asteroid.Id] });
+			}
+
+			// time the submission on the CPU and its execution on the GPU
+			double start = glfwGetTime();
+			unsigned int query = frameIndex % 2;
+			glBeginQuery(GL_TIME_ELAPSED, timerQueries[query]);
+			drawCalls = 0;
+			if (singlePass) {
+				multiview.upload();
+				multiviewShader.use();
+				multiview.enableClipping();
+				for (const SplitDraw &draw : splitDraws) {
+					multiviewShader.setInt("viewMask", (int)draw.Mask);
+					multiviewShader.setMat4("model", draw.Model);
+					unsigned int instances = MultiView::instanceNum(draw.Mask);
+					if (draw.Level < 0) cube.drawInstanced(instances);
+					else                sphere.drawInstanced(draw.Level, instances);
+					++drawCalls;
+				}
+				multiview.disableClipping();
+			}
+			else {
+				shader.setMat4("view", glm::mat4(1.0f));
+				for (unsigned int v = 0; v < MAX_VIEWS; ++v) {
+					GLState::get().viewport((int)tileX[v], (int)tileY[v], (int)(screenWidth / 2), (int)(screenHeight / 2));
+					shader.setMat4("projection", viewProjections[v]);
+					for (const SplitDraw &draw : splitDraws) {
+						if (!(draw.Mask & (1u << v))) continue;
+						shader.setMat4("model", draw.Model);
+						if (draw.Level < 0) cube.draw();
+						else                sphere.draw(draw.Level);
+						++drawCalls;
+					}
+				}
+				GLState::get().viewport(0, 0, headless.width(), headless.height());
+			}
+			glEndQuery(GL_TIME_ELAPSED);
+			timerIssued[query] = true;
+			cpuTime = cpuTime * 0.95f + (float)(glfwGetTime() - start) * 1000.0f * 0.05f;
+
+			// read the query of the previous frame, which has had a frame to finish
+			unsigned int previous = 1 - query;
+			int available = 0;
+			if (timerIssued[previous]) glGetQueryObjectiv(timerQueries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(timerQueries[previous], GL_QUERY_RESULT, &elapsed);
+				gpuTime = gpuTime * 0.95f + (float)(elapsed / 1.0e6) * 0.05f;
+			}
+			++frameIndex;
+
+			ImGui::Begin("Split Screen");
+			ImGui::Checkbox("Single pass", &singlePass);
+			ImGui::Text("Objects: %u, draw calls: %u", (unsigned int)splitDraws.size(), drawCalls);
+			ImGui::Text("CPU: %.3f ms, GPU: %.3f ms", cpuTime, gpuTime);
+			ImGui::End();
+		}
+
+		if (type != 0 && type != 5) {
 			if (type == 1 || type == 2) {
 				// move the cube from (0, 0, 0) to (-1.5, 0.5, -1.5)
 				model = glm::translate(model, glm::vec3(-1.5f, 0.5f, -1.5f));
@@ -262,22 +545,37 @@ int main() {
 			shader.setMat4("view", view);
 			shader.setMat4("projection", proj);
 
-			glBindVertexArray(VAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			cube.draw();
 		}
 		
+		// read the frame back before the UI is drawn over it
+		capture.capture();
+
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// the ImGui renderer binds its own objects behind the cache's back
+		GLState::get().invalidate();
+
+		resources.endFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		headless.endFrame(window);
 	}
 
 	// cleanup
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+	cube.release();
+	sphere.release();
+	multiview.release();
+	glDeleteQueries(2, timerQueries);
+	shader.release();
+	multiviewShader.release();
+	capture.release();
+	headless.release();
+	// anything still alive now is reported as a leak
+	resources.release();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -287,7 +585,35 @@ int main() {
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
+}
+
+// UV sphere centered at the origin, colored by its normal
+// -------------------------------------------------------
+Mesh buildSphere(float radius, unsigned int rings, unsigned int sectors) {
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	for (unsigned int r = 0; r <= rings; ++r) {
+		for (unsigned int s = 0; s <= sectors; ++s) {
+			float theta = glm::radians(180.0f * r / rings);
+			float phi = glm::radians(360.0f * s / sectors);
+			glm::vec3 normal(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+			// the seam and the poles must share exact positions to be welded by the simplifier
+			if (s == sectors) normal = glm::vec3(sin(theta), cos(theta), 0.0f);
+			if (r == 0 || r == rings) normal = glm::vec3(0.0f, r == 0 ? 1.0f : -1.0f, 0.0f);
+			glm::vec3 position = normal * radius, color = normal * 0.5f + 0.5f;
+			vertices.insert(vertices.end(), { position.x, position.y, position.z, color.x, color.y, color.z });
+		}
+	}
+	for (unsigned int r = 0; r < rings; ++r) {
+		for (unsigned int s = 0; s < sectors; ++s) {
+			unsigned int a = r * (sectors + 1) + s, b = a + sectors + 1;
+			// skip the triangles collapsed into a pole
+			if (r != 0)         indices.insert(indices.end(), { a, b, a + 1 });
+			if (r != rings - 1) indices.insert(indices.end(), { a + 1, b, b + 1 });
+		}
+	}
+	return Mesh(vertices, indices, { 3, 3 });
 }
 
 // keyboard input event callback
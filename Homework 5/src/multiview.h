@@ -0,0 +1,94 @@
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.h"
+#include "gl_resources.h"
+
+// Default multi-view options, must match multiview.vs
+const unsigned int MAX_VIEWS     = 4;
+const unsigned int VIEWS_BINDING = 0; // uniform buffer binding point of the Views block
+
+// std140 layout of the Views block
+struct ViewBlock {
+	glm::mat4 ViewProjection[MAX_VIEWS];
+	glm::vec4 Tiles[MAX_VIEWS];
+};
+static_assert(sizeof(ViewBlock) == MAX_VIEWS * 80, "ViewBlock must match the std140 layout of Views");
+
+// Renders one scene into several viewport tiles in a single pass: every draw
+// is instanced once per view it is visible in, multiview.vs selects the view
+// matrices from a uniform buffer and squeezes the result into the view's tile,
+// clipping against the tile edges with gl_ClipDistance.
+class MultiView {
+public:
+	ViewBlock Block;
+	unsigned int ViewCount;
+	unsigned int UBO;
+	BufferHandle Buffer; // UBO in the GLResources pool
+
+	MultiView() : ViewCount(0), UBO(0) {
+		Buffer = GLResources::get().createBuffer();
+		UBO = GLResources::get().name(Buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewBlock), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		GLResources::get().setMemory(Buffer, sizeof(ViewBlock));
+	}
+
+	// connects the Views block of a shader to the buffer
+	void bind(const Shader &shader) const {
+		unsigned int index = glGetUniformBlockIndex(shader.ID, "Views");
+		if (index == GL_INVALID_INDEX) {
+			std::cout << "ERROR::MULTIVIEW::VIEWS_BLOCK_NOT_FOUND" << std::endl;
+			return;
+		}
+		glUniformBlockBinding(shader.ID, index, VIEWS_BINDING);
+	}
+
+	// Sets view `i` rendering into the pixel rectangle (x, y, width, height) of
+	// a screenWidth * screenHeight framebuffer
+	void setView(unsigned int i, const glm::mat4 &viewProjection, float x, float y, float width, float height, float screenWidth, float screenHeight) {
+		Block.ViewProjection[i] = viewProjection;
+		Block.Tiles[i] = glm::vec4(
+			(x + width * 0.5f) / screenWidth * 2.0f - 1.0f,
+			(y + height * 0.5f) / screenHeight * 2.0f - 1.0f,
+			width / screenWidth,
+			height / screenHeight);
+		if (i >= ViewCount) ViewCount = i + 1;
+	}
+
+	// uploads the views of this frame, call once before drawing
+	void upload() const {
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ViewBlock), &Block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, VIEWS_BINDING, UBO);
+	}
+
+	// number of instances a draw visible in the views of `mask` needs
+	static unsigned int instanceNum(unsigned int mask) {
+		unsigned int count = 0;
+		for (; mask; mask &= mask - 1) ++count;
+		return count;
+	}
+
+	void enableClipping() const {
+		for (unsigned int i = 0; i < 4; ++i) glEnable(GL_CLIP_DISTANCE0 + i);
+	}
+
+	void disableClipping() const {
+		for (unsigned int i = 0; i < 4; ++i) glDisable(GL_CLIP_DISTANCE0 + i);
+	}
+
+	// de-allocate GL objects, must be called while the context is alive
+	void release() {
+		GLResources::get().destroy(Buffer);
+		UBO = 0;
+	}
+};
+
+#endif // !MULTIVIEW_H
@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+out vec3 ourColor;
+out float gl_ClipDistance[4];
+
+const int MAX_VIEWS = 4;
+
+layout (std140) uniform Views {
+	mat4 viewProjection[MAX_VIEWS];
+	// viewport tile of every view in NDC: xy center, zw half size
+	vec4 tiles[MAX_VIEWS];
+};
+
+uniform mat4 model;
+// views this draw is visible in, instance i renders into the i-th set bit
+uniform int viewMask;
+
+void main() {
+	int view = 0;
+	int instance = gl_InstanceID;
+	for (int i = 0; i < MAX_VIEWS; ++i) {
+		if ((viewMask & (1 << i)) == 0) continue;
+		view = i;
+		if (instance-- == 0) break;
+	}
+
+	vec4 clip = viewProjection[view] * model * vec4(aPos, 1.0f);
+	// clip against the view's own frustum sides, then squeeze it into its tile
+	gl_ClipDistance[0] = clip.w + clip.x;
+	gl_ClipDistance[1] = clip.w - clip.x;
+	gl_ClipDistance[2] = clip.w + clip.y;
+	gl_ClipDistance[3] = clip.w - clip.y;
+	gl_Position = vec4(clip.xy * tiles[view].zw + tiles[view].xy * clip.w, clip.zw);
+	ourColor = aColor;
+}
\ No newline at end of file
@@ -0,0 +1,279 @@
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "frustum.h"
+
+// Default octree options
+const unsigned int OCTREE_MAX_DEPTH = 8;
+const unsigned int OCTREE_NONE      = 0xFFFFFFFFu;
+
+// Loose octree (Ulrich, "Loose Octrees") of bounding spheres. Every node's
+// bounds are twice its cell size, so an object is stored in exactly one node,
+// chosen directly from its radius and center without descending the tree:
+// inserting and moving are O(depth), and an object that stays within its cell
+// moves in O(1).
+//
+// Nodes and objects live in pools indexed by unsigned ints, freed slots are
+// recycled through free lists. Objects of a node form an intrusive doubly
+// linked list so they can be unlinked in O(1).
+class LooseOctree {
+public:
+	struct Node {
+		glm::vec3 Center;
+		float HalfSize;        // half of the cell size, the loose bounds are twice as large
+		unsigned int Depth;
+		int Cell[3];           // cell coordinates at Depth
+		unsigned int Parent;
+		unsigned int Children[8];
+		unsigned int FirstObject;
+		unsigned int ObjectCount;
+		unsigned int ChildCount;
+	};
+
+	struct Object {
+		glm::vec3 Center;
+		float Radius;
+		unsigned int Node;     // OCTREE_NONE for free slots
+		unsigned int Prev, Next;
+	};
+
+	std::vector<Node> Nodes;
+	std::vector<Object> Objects;
+
+	LooseOctree(const glm::vec3 &center, float halfSize, unsigned int maxDepth = OCTREE_MAX_DEPTH) :
+		MaxDepth(maxDepth), freeNodes(OCTREE_NONE), freeObjects(OCTREE_NONE), liveNodes(0), liveObjects(0)
+	{
+		origin = center - glm::vec3(halfSize);
+		size = halfSize * 2.0f;
+		root = allocNode(OCTREE_NONE, 0, 0, 0, 0);
+	}
+
+	// returns the id of the new object
+	unsigned int insert(const glm::vec3 &center, float radius) {
+		unsigned int id;
+		if (freeObjects != OCTREE_NONE) {
+			id = freeObjects;
+			freeObjects = Objects[id].Next;
+		}
+		else {
+			id = (unsigned int)Objects.size();
+			Objects.push_back(Object());
+		}
+		Objects[id].Center = center;
+		Objects[id].Radius = radius;
+		link(id, findNode(center, radius));
+		++liveObjects;
+		return id;
+	}
+
+	void move(unsigned int id, const glm::vec3 &center, float radius) {
+		Object &object = Objects[id];
+		object.Center = center;
+		object.Radius = radius;
+		int depth, cell[3];
+		locate(center, radius, depth, cell);
+		const Node &node = Nodes[object.Node];
+		if ((int)node.Depth == depth && node.Cell[0] == cell[0] && node.Cell[1] == cell[1] && node.Cell[2] == cell[2])
+			return;
+		unsigned int old = object.Node;
+		unlink(id);
+		link(id, descend(depth, cell));
+		prune(old);
+	}
+
+	void remove(unsigned int id) {
+		unsigned int old = Objects[id].Node;
+		unlink(id);
+		prune(old);
+		Objects[id].Node = OCTREE_NONE;
+		Objects[id].Next = freeObjects;
+		freeObjects = id;
+		--liveObjects;
+	}
+
+	// appends the ids of all objects intersecting the frustum
+	void queryFrustum(const Frustum &frustum, std::vector<unsigned int> &result) const {
+		stack.assign(1, root);
+		while (!stack.empty()) {
+			unsigned int n = stack.back();
+			stack.pop_back();
+			const Node &node = Nodes[n];
+			// the root also holds objects outside the world, it is never culled
+			Frustum_Test test = n == root ? INTERSECT : frustum.testBox(node.Center - glm::vec3(node.HalfSize * 2.0f), node.Center + glm::vec3(node.HalfSize * 2.0f));
+			if (test == OUTSIDE) continue;
+			if (test == INSIDE) {
+				collect(n, result);
+				continue;
+			}
+			for (unsigned int o = node.FirstObject; o != OCTREE_NONE; o = Objects[o].Next)
+				if (frustum.testSphere(Objects[o].Center, Objects[o].Radius) != OUTSIDE)
+					result.push_back(o);
+			pushChildren(node);
+		}
+	}
+
+	// appends the ids of all objects intersecting the sphere
+	void queryRadius(const glm::vec3 &center, float radius, std::vector<unsigned int> &result) const {
+		stack.assign(1, root);
+		while (!stack.empty()) {
+			const Node &node = Nodes[stack.back()];
+			bool isRoot = stack.back() == root;
+			stack.pop_back();
+			if (!isRoot) {
+				glm::vec3 d = glm::max(glm::abs(center - node.Center) - glm::vec3(node.HalfSize * 2.0f), glm::vec3(0.0f));
+				if (glm::dot(d, d) > radius * radius) continue;
+			}
+			for (unsigned int o = node.FirstObject; o != OCTREE_NONE; o = Objects[o].Next) {
+				float reach = radius + Objects[o].Radius;
+				glm::vec3 d = Objects[o].Center - center;
+				if (glm::dot(d, d) <= reach * reach) result.push_back(o);
+			}
+			pushChildren(node);
+		}
+	}
+
+	unsigned int nodeNum() const { return liveNodes; }
+	unsigned int objectNum() const { return liveObjects; }
+
+private:
+	unsigned int MaxDepth;
+	glm::vec3 origin;
+	float size;
+	unsigned int root;
+	unsigned int freeNodes, freeObjects;
+	unsigned int liveNodes, liveObjects;
+	// traversal stack reused by the queries
+	mutable std::vector<unsigned int> stack;
+
+	// Deepest node whose loose bounds contain the sphere: at depth d the cell
+	// size is size / 2^d and a sphere centered in the cell fits if its radius is
+	// at most half the cell size
+	void locate(const glm::vec3 &center, float radius, int &depth, int cell[3]) const {
+		depth = (int)MaxDepth;
+		if (radius > 0.0f) depth = std::min(depth, (int)std::floor(std::log2(size / (2.0f * radius))));
+		for (; depth > 0; --depth) {
+			int cells = 1 << depth;
+			float cellSize = size / cells;
+			bool fits = true;
+			for (int k = 0; k < 3; ++k) {
+				cell[k] = std::min(std::max((int)std::floor((center[k] - origin[k]) / cellSize), 0), cells - 1);
+				// centers outside the world are clamped to a border cell, check they still fit
+				float offset = std::fabs(center[k] - (origin[k] + (cell[k] + 0.5f) * cellSize));
+				if (offset + radius > cellSize) fits = false;
+			}
+			if (fits) return;
+		}
+		depth = 0;
+		cell[0] = cell[1] = cell[2] = 0;
+	}
+
+	unsigned int findNode(const glm::vec3 &center, float radius) {
+		int depth, cell[3];
+		locate(center, radius, depth, cell);
+		return descend(depth, cell);
+	}
+
+	// walks from the root to the node of a cell, creating missing nodes
+	unsigned int descend(int depth, const int cell[3]) {
+		unsigned int n = root;
+		for (int d = 1; d <= depth; ++d) {
+			int shift = depth - d;
+			int x = cell[0] >> shift, y = cell[1] >> shift, z = cell[2] >> shift;
+			unsigned int octant = (x & 1) | ((y & 1) << 1) | ((z & 1) << 2);
+			unsigned int child = Nodes[n].Children[octant];
+			if (child == OCTREE_NONE) {
+				child = allocNode(n, d, x, y, z);
+				Nodes[n].Children[octant] = child;
+				++Nodes[n].ChildCount;
+			}
+			n = child;
+		}
+		return n;
+	}
+
+	unsigned int allocNode(unsigned int parent, int depth, int x, int y, int z) {
+		unsigned int n;
+		if (freeNodes != OCTREE_NONE) {
+			n = freeNodes;
+			freeNodes = Nodes[n].Parent;
+		}
+		else {
+			n = (unsigned int)Nodes.size();
+			Nodes.push_back(Node());
+		}
+		Node &node = Nodes[n];
+		float cellSize = size / (1 << depth);
+		node.HalfSize = cellSize * 0.5f;
+		node.Center = origin + (glm::vec3((float)x, (float)y, (float)z) + 0.5f) * cellSize;
+		node.Depth = depth;
+		node.Cell[0] = x;
+		node.Cell[1] = y;
+		node.Cell[2] = z;
+		node.Parent = parent;
+		std::fill(node.Children, node.Children + 8, OCTREE_NONE);
+		node.FirstObject = OCTREE_NONE;
+		node.ObjectCount = 0;
+		node.ChildCount = 0;
+		++liveNodes;
+		return n;
+	}
+
+	// returns empty leaves to the pool, walking up while parents become empty
+	void prune(unsigned int n) {
+		while (n != root && Nodes[n].ObjectCount == 0 && Nodes[n].ChildCount == 0) {
+			unsigned int parent = Nodes[n].Parent;
+			for (unsigned int &child : Nodes[parent].Children) {
+				if (child == n) child = OCTREE_NONE;
+			}
+			--Nodes[parent].ChildCount;
+			Nodes[n].Parent = freeNodes;
+			freeNodes = n;
+			--liveNodes;
+			n = parent;
+		}
+	}
+
+	void link(unsigned int id, unsigned int n) {
+		Object &object = Objects[id];
+		object.Node = n;
+		object.Prev = OCTREE_NONE;
+		object.Next = Nodes[n].FirstObject;
+		if (object.Next != OCTREE_NONE) Objects[object.Next].Prev = id;
+		Nodes[n].FirstObject = id;
+		++Nodes[n].ObjectCount;
+	}
+
+	void unlink(unsigned int id) {
+		Object &object = Objects[id];
+		if (object.Prev != OCTREE_NONE) Objects[object.Prev].Next = object.Next;
+		else Nodes[object.Node].FirstObject = object.Next;
+		if (object.Next != OCTREE_NONE) Objects[object.Next].Prev = object.Prev;
+		--Nodes[object.Node].ObjectCount;
+	}
+
+	void pushChildren(const Node &node) const {
+		for (unsigned int child : node.Children)
+			if (child != OCTREE_NONE) stack.push_back(child);
+	}
+
+	// every object below a node that is fully inside a query, no more tests needed
+	void collect(unsigned int n, std::vector<unsigned int> &result) const {
+		size_t base = stack.size();
+		stack.push_back(n);
+		while (stack.size() > base) {
+			const Node &node = Nodes[stack.back()];
+			stack.pop_back();
+			for (unsigned int o = node.FirstObject; o != OCTREE_NONE; o = Objects[o].Next)
+				result.push_back(o);
+			pushChildren(node);
+		}
+	}
+};
+
+#endif // !OCTREE_H
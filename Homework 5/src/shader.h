@@ -8,129 +8,611 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <utility>
+#include <memory>
+
+#include "gl_state.h"
+#include "gl_resources.h"
 
 // This class is referenced in "LearnOpenGL"
 
+// Linked programs are cached as driver binaries in SHADER_CACHE_DIR, one file
+// per program named after a hash of its sources and of the driver. A binary
+// the driver refuses (e.g. after an update) is replaced by a fresh link.
+// The cache needs glad generated with GL 4.1 or GL_ARB_get_program_binary;
+// with a plain 3.3 core glad every program is linked from source.
+#if defined(GL_ARB_get_program_binary) || defined(GL_VERSION_4_1)
+#define SHADER_BINARY_CACHE
+#endif
+const char SHADER_CACHE_DIR[] = "shader_cache";
+const char SHADER_CACHE_MAGIC[8] = { 'C', 'G', 'P', 'R', 'O', 'G', '\r', '\n' };
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+// Compile-time options of one program variant, inserted into every stage as
+// `#define NAME VALUE` right after the #version line
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+struct ShaderCacheHeader {
+	char Magic[8];
+	uint32_t Version;
+	uint32_t Format; // binary format reported by glGetProgramBinary
+	uint64_t Key;
+	uint64_t Size;   // bytes of the binary following the header
+};
+static_assert(sizeof(ShaderCacheHeader) == 32, "ShaderCacheHeader layout changed, bump SHADER_CACHE_VERSION");
+
+// GL uniform traffic of all shaders, reset once per frame by the caller
+struct UniformStats {
+	unsigned int Issued;  // glUniform* calls made
+	unsigned int Skipped; // calls saved because the value was already set or the uniform is inactive
+};
+
+// Uniform of one linked program, resolved once by Shader::handle() so that
+// setting it skips the lookup by name. A program rebuilt by the ShaderWatcher
+// has a table of its own: handles of the replaced one are ignored and must be
+// resolved again.
+struct UniformHandle {
+	ProgramHandle Program; // null for a uniform the linker removed
+	unsigned int Index;    // in the uniform table of Program
+
+	UniformHandle() : Index(0) {}
+	UniformHandle(ProgramHandle program, unsigned int index) : Program(program), Index(index) {}
+
+	bool valid() const {
+		return Program.valid();
+	}
+};
+
 class Shader {
 public:
 	unsigned int ID;
-	// constructor generates the shader on the fly
-	// ------------------------------------------------------------------------
-	Shader(const char* vertexPath, const char* fragmentPath) {
-		// 1. retrieve the vertex/fragment source code from filePath
-		std::string vertexCode;
-		std::string fragmentCode;
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-		// ensure ifstream objects can throw exceptions:
-		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		try {
-			// open files
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-			std::stringstream vShaderStream, fShaderStream;
-			// read file's buffer contents into streams
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			// close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			// convert stream into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-		}
-		catch (std::ifstream::failure e) {
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-		}
-		const char* vShaderCode = vertexCode.c_str();
-		const char * fShaderCode = fragmentCode.c_str();
-		// 2. compile shaders
-		unsigned int vertex, fragment;
+	ProgramHandle Program; // ID in the GLResources pool
+
+	// Active uniform found when the program was linked. Value caches the last
+	// upload so setting the same value again costs no GL call.
+	struct Uniform {
+		GLint Location;
+		GLenum Type;
+		unsigned int Size; // bytes of Value in use, 0 until the first upload
+		unsigned char Value[64];
+	};
+
+	static UniformStats &stats() {
+		static UniformStats counters = { 0, 0 };
+		return counters;
+	}
+	static void resetStats() {
+		stats().Issued = stats().Skipped = 0;
+	}
+
+	bool Ready;      // linked and introspected, uniforms can be set
+	bool Valid;      // Ready and linked without errors
+	bool FromCache;  // linked from a cached binary instead of the sources
+	double LoadTime; // milliseconds from construction until Ready
+	// constructor generates the shader on the fly. A deferred shader only reads
+	// its sources, compile() and finish() are left to the caller (see
+	// ShaderCompiler) unless the program was found in the binary cache.
+	// ------------------------------------------------------------------------
+	Shader(const char* vertexPath, const char* fragmentPath, bool deferred = false) :
+		Shader(vertexPath, fragmentPath, ShaderDefines(), deferred) {}
+	// same with `defines` selecting a variant, see preprocess()
+	// ------------------------------------------------------------------------
+	Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines &defines, bool deferred = false) :
+		Ready(false), Valid(false), FromCache(false), LoadTime(0.0), start(std::chrono::steady_clock::now()),
+		vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines), vertex(0), fragment(0)
+	{
+		// 1. retrieve the vertex/fragment source code from filePath, resolving includes
+		std::string vertexCode = preprocess(vertexPath, defines, vertexFiles);
+		std::string fragmentCode = preprocess(fragmentPath, defines, fragmentFiles);
+		// 2. try the binary of a previous run
+		Program = GLResources::get().createProgram();
+		ID = GLResources::get().name(Program);
+		key = cacheKey(vertexCode, fragmentCode);
+		if (loadBinary(key)) {
+			FromCache = true;
+			finish();
+			return;
+		}
+		vertexSource = vertexCode;
+		fragmentSource = fragmentCode;
+		if (!deferred) {
+			compile();
+			finish();
+		}
+	}
+	// Issues compiling and linking. Returns without waiting when the driver
+	// compiles in parallel, may run on a thread owning a context shared with
+	// the one the shader was created in.
+	// ------------------------------------------------------------------------
+	void compile() {
+		if (Ready || vertex != 0) return;
+		const char* vShaderCode = vertexSource.c_str();
+		const char * fShaderCode = fragmentSource.c_str();
+		// 3. compile shaders
 		// vertex shader
 		vertex = glCreateShader(GL_VERTEX_SHADER);
 		glShaderSource(vertex, 1, &vShaderCode, NULL);
 		glCompileShader(vertex);
-		checkCompileErrors(vertex, "VERTEX");
 		// fragment Shader
 		fragment = glCreateShader(GL_FRAGMENT_SHADER);
 		glShaderSource(fragment, 1, &fShaderCode, NULL);
 		glCompileShader(fragment);
-		checkCompileErrors(fragment, "FRAGMENT");
 		// shader Program
-		ID = glCreateProgram();
 		glAttachShader(ID, vertex);
 		glAttachShader(ID, fragment);
+#ifdef SHADER_BINARY_CACHE
+		if (binarySupported()) glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
 		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
-		// delete the shaders as they're linked into our program now and no longer necessery
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
-
 	}
-	// activate the shader
+	// true once a link issued by compile() has completed, never blocks
+	// ------------------------------------------------------------------------
+	bool linked() const {
+		if (Ready) return true;
+		if (vertex == 0) return false;
+		GLint done = GL_TRUE;
+		GLenum status = completionStatus();
+		if (status != 0) glGetProgramiv(ID, status, &done);
+		return done != GL_FALSE;
+	}
+	// the query telling whether a link has completed when the driver compiles
+	// in parallel, 0 if glad has no KHR/ARB_parallel_shader_compile or the
+	// driver does not support it
+	// ------------------------------------------------------------------------
+	static GLenum completionStatus() {
+#ifdef GL_KHR_parallel_shader_compile
+		if (GLAD_GL_KHR_parallel_shader_compile) return GL_COMPLETION_STATUS_KHR;
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+		if (GLAD_GL_ARB_parallel_shader_compile) return GL_COMPLETION_STATUS_ARB;
+#endif
+		return 0;
+	}
+	// Reports errors, stores the binary and looks up the uniforms. Blocks until
+	// the link has completed, call it on the thread that renders.
+	// ------------------------------------------------------------------------
+	void finish() {
+		if (Ready) return;
+		if (!FromCache) {
+			compile();
+			checkCompileErrors(vertex, "VERTEX", &vertexFiles);
+			checkCompileErrors(fragment, "FRAGMENT", &fragmentFiles);
+			checkCompileErrors(ID, "PROGRAM");
+			// delete the shaders as they're linked into our program now and no longer necessery
+			glDetachShader(ID, vertex);
+			glDetachShader(ID, fragment);
+			glDeleteShader(vertex);
+			glDeleteShader(fragment);
+			saveBinary(key);
+			vertexSource.clear();
+			fragmentSource.clear();
+		}
+		GLint success = GL_FALSE;
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		Valid = success != GL_FALSE;
+		// look up every uniform once instead of on each set call
+		introspect();
+		LoadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Ready = true;
+	}
+	// de-allocate GL objects, must be called while the context is alive. The
+	// program is deleted once the frames using it are done, see GLResources
+	// ------------------------------------------------------------------------
+	void release() {
+		GLResources::get().destroy(Program);
+		ID = 0;
+	}
+	// a new deferred shader built from the current contents of the same files
+	// ------------------------------------------------------------------------
+	std::unique_ptr<Shader> rebuild() const {
+		return std::unique_ptr<Shader>(new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines, true));
+	}
+	// every file read for this program, includes too
+	// ------------------------------------------------------------------------
+	std::vector<std::string> sourceFiles() const {
+		std::vector<std::string> files(vertexFiles);
+		files.insert(files.end(), fragmentFiles.begin(), fragmentFiles.end());
+		return files;
+	}
+	// activate the shader, skipped if it is already current
 	// ------------------------------------------------------------------------
 	void use() const {
-		glUseProgram(ID);
+		GLState::get().useProgram(ID);
 	}
-	// utility uniform functions
+	// handle of an active uniform for set(), invalid if the linker removed it
 	// ------------------------------------------------------------------------
-	void setBool(const std::string &name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	UniformHandle handle(const std::string &name) const {
+		auto it = uniformIndices.find(name);
+		return it == uniformIndices.end() ? UniformHandle() : UniformHandle(Program, it->second);
 	}
+	// uniform functions by handle, values equal to the last upload are skipped
+	// and values not matching the GLSL type are reported and dropped. Ints
+	// also set bools and samplers.
 	// ------------------------------------------------------------------------
-	void setInt(const std::string &name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	void set(UniformHandle handle, int value) const {
+		if (const Uniform* u = update(handle, GL_INT, &value, sizeof(value))) glUniform1i(u->Location, value);
+	}
+	void set(UniformHandle handle, float value) const {
+		if (const Uniform* u = update(handle, GL_FLOAT, &value, sizeof(value))) glUniform1f(u->Location, value);
+	}
+	void set(UniformHandle handle, const glm::vec2 &value) const {
+		if (const Uniform* u = update(handle, GL_FLOAT_VEC2, &value[0], sizeof(float) * 2)) glUniform2fv(u->Location, 1, &value[0]);
 	}
+	void set(UniformHandle handle, const glm::vec3 &value) const {
+		if (const Uniform* u = update(handle, GL_FLOAT_VEC3, &value[0], sizeof(float) * 3)) glUniform3fv(u->Location, 1, &value[0]);
+	}
+	void set(UniformHandle handle, const glm::vec4 &value) const {
+		if (const Uniform* u = update(handle, GL_FLOAT_VEC4, &value[0], sizeof(float) * 4)) glUniform4fv(u->Location, 1, &value[0]);
+	}
+	void set(UniformHandle handle, const glm::mat2 &mat) const {
+		if (const Uniform* u = update(handle, GL_FLOAT_MAT2, &mat[0][0], sizeof(float) * 4)) glUniformMatrix2fv(u->Location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void set(UniformHandle handle, const glm::mat3 &mat) const {
+		if (const Uniform* u = update(handle, GL_FLOAT_MAT3, &mat[0][0], sizeof(float) * 9)) glUniformMatrix3fv(u->Location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void set(UniformHandle handle, const glm::mat4 &mat) const {
+		if (const Uniform* u = update(handle, GL_FLOAT_MAT4, &mat[0][0], sizeof(float) * 16)) glUniformMatrix4fv(u->Location, 1, GL_FALSE, &mat[0][0]);
+	}
+	// utility uniform functions by name, looked up on every call
 	// ------------------------------------------------------------------------
+	void setBool(const std::string &name, bool value) const {
+		set(handle(name), (int)value);
+	}
+	void setInt(const std::string &name, int value) const {
+		set(handle(name), value);
+	}
 	void setFloat(const std::string &name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		set(handle(name), value);
 	}
-	// ------------------------------------------------------------------------
 	void setVec2(const std::string &name, const glm::vec2 &value) const {
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		set(handle(name), value);
 	}
 	void setVec2(const std::string &name, float x, float y) const {
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		set(handle(name), glm::vec2(x, y));
 	}
-	// ------------------------------------------------------------------------
 	void setVec3(const std::string &name, const glm::vec3 &value) const {
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		set(handle(name), value);
 	}
 	void setVec3(const std::string &name, float x, float y, float z) const {
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		set(handle(name), glm::vec3(x, y, z));
 	}
-	// ------------------------------------------------------------------------
 	void setVec4(const std::string &name, const glm::vec4 &value) const {
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		set(handle(name), value);
 	}
 	void setVec4(const std::string &name, float x, float y, float z, float w) const {
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		set(handle(name), glm::vec4(x, y, z, w));
 	}
-	// ------------------------------------------------------------------------
 	void setMat2(const std::string &name, const glm::mat2 &mat) const {
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		set(handle(name), mat);
 	}
-	// ------------------------------------------------------------------------
 	void setMat3(const std::string &name, const glm::mat3 &mat) const {
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		set(handle(name), mat);
 	}
-	// ------------------------------------------------------------------------
 	void setMat4(const std::string &name, const glm::mat4 &mat) const {
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		set(handle(name), mat);
+	}
+	// prints how the program was built and how long it took
+	void printStats(const std::string &name) const {
+		std::cout << "SHADER::" << name << ": " << (FromCache ? "loaded from binary cache" : "compiled from source")
+			<< " in " << LoadTime << " ms" << std::endl;
+	}
+	// Reads a shader file and expands `#include "file"` lines, paths being
+	// relative to the including file and every file included once. `defines`
+	// follow the #version line. #line directives keep compiler messages at the
+	// right line, their source string number is the index of the file in `files`.
+	// ------------------------------------------------------------------------
+	static std::string preprocess(const std::string &path, const ShaderDefines &defines, std::vector<std::string> &files) {
+		files.clear();
+		std::string out;
+		expand(path, defines, files, out);
+		return out;
+	}
+	// active uniform by name, NULL if the linker removed it
+	// ------------------------------------------------------------------------
+	const Uniform* uniform(const std::string &name) const {
+		auto it = uniformIndices.find(name);
+		return it == uniformIndices.end() ? NULL : &uniforms[it->second];
 	}
 
 private:
+	// state of a compile in flight
+	std::chrono::steady_clock::time_point start;
+	std::string vertexPath, fragmentPath;
+	ShaderDefines defines;
+	uint64_t key;
+	std::string vertexSource, fragmentSource;
+	// files read for each stage, indexed by the #line source string numbers
+	std::vector<std::string> vertexFiles, fragmentFiles;
+	unsigned int vertex, fragment;
+
+	// active uniforms, and their index by name. Array elements are listed as
+	// "name[i]", the bare array name shares the entry of element 0 like it
+	// shares its location
+	mutable std::vector<Uniform> uniforms;
+	std::unordered_map<std::string, unsigned int> uniformIndices;
+
+	// fills the uniform table from the linked program
+	// ------------------------------------------------------------------------
+	void introspect() {
+		uniforms.clear();
+		uniformIndices.clear();
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<GLchar> buffer(maxLength + 1);
+		for (GLint i = 0; i < count; ++i) {
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), NULL, &size, &type, buffer.data());
+			std::string name(buffer.data());
+			// uniforms of blocks have no location
+			GLint location = glGetUniformLocation(ID, name.c_str());
+			if (location < 0) continue;
+
+			Uniform entry = { location, type, 0, { 0 } };
+			// arrays of basic types are reported once as "name[0]"
+			if (name.size() < 3 || name.compare(name.size() - 3, 3, "[0]") != 0) {
+				uniformIndices[name] = (unsigned int)uniforms.size();
+				uniforms.push_back(entry);
+				continue;
+			}
+			std::string base = name.substr(0, name.size() - 3);
+			uniformIndices[base] = (unsigned int)uniforms.size();
+			for (GLint e = 0; e < size; ++e) {
+				std::string element = base + "[" + std::to_string(e) + "]";
+				entry.Location = glGetUniformLocation(ID, element.c_str());
+				if (entry.Location < 0) continue;
+				uniformIndices[element] = (unsigned int)uniforms.size();
+				uniforms.push_back(entry);
+			}
+		}
+	}
+
+	// Returns the uniform to upload a value of `type` to, or NULL if the call
+	// can be skipped because the uniform is inactive, belongs to another
+	// program, has another type or already holds the value
+	// ------------------------------------------------------------------------
+	Uniform* update(UniformHandle handle, GLenum type, const void* value, unsigned int size) const {
+		if (!handle.valid() || handle.Program.Index != Program.Index || handle.Program.Generation != Program.Generation) {
+			++stats().Skipped;
+			return NULL;
+		}
+		Uniform &u = uniforms[handle.Index];
+		if (!accepts(u.Type, type)) {
+			std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: 0x" << std::hex << u.Type << " set with 0x" << type << std::dec << std::endl;
+			++stats().Skipped;
+			return NULL;
+		}
+		if (u.Size == size && std::memcmp(u.Value, value, size) == 0) {
+			++stats().Skipped;
+			return NULL;
+		}
+		u.Size = size;
+		std::memcpy(u.Value, value, size);
+		++stats().Issued;
+		return &u;
+	}
+
+	// whether a value of `type` may be uploaded to a uniform of `uniformType`
+	static bool accepts(GLenum uniformType, GLenum type) {
+		if (uniformType == type) return true;
+		if (type != GL_INT) return false;
+		switch (uniformType) {
+		case GL_BOOL:
+		case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_BUFFER:
+		case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+		case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_RECT:
+		case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+		case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool readFile(const std::string &path, std::string &text) {
+		std::ifstream file;
+		// ensure ifstream objects can throw exceptions:
+		file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		try {
+			file.open(path);
+			std::stringstream stream;
+			stream << file.rdbuf();
+			file.close();
+			text = stream.str();
+			return true;
+		}
+		catch (std::ifstream::failure &e) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+			return false;
+		}
+	}
+
+	// appends the expanded file `path` to `out`
+	// ------------------------------------------------------------------------
+	static void expand(const std::string &path, const ShaderDefines &defines, std::vector<std::string> &files, std::string &out) {
+		for (const std::string &file : files)
+			if (file == path) return;
+		std::string text;
+		if (!readFile(path, text)) return;
+		unsigned int index = (unsigned int)files.size();
+		files.push_back(path);
+		std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+		std::istringstream lines(text);
+		std::string line;
+		for (unsigned int number = 1; std::getline(lines, line); ++number) {
+			size_t first = line.find_first_not_of(" \t");
+			if (first != std::string::npos && line.compare(first, 8, "#include") == 0) {
+				size_t open = line.find('"', first), close = line.find('"', open + 1);
+				if (open == std::string::npos || close == std::string::npos) {
+					std::cout << "ERROR::SHADER::MALFORMED_INCLUDE: " << path << ":" << number << std::endl;
+					continue;
+				}
+				out += "#line 1 " + std::to_string(files.size()) + "\n";
+				expand(directory + line.substr(open + 1, close - open - 1), defines, files, out);
+				out += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+				continue;
+			}
+			out += line;
+			out += '\n';
+			if (index == 0 && first != std::string::npos && line.compare(first, 8, "#version") == 0) {
+				for (const auto &define : defines)
+					out += "#define " + define.first + " " + define.second + "\n";
+				out += "#line " + std::to_string(number + 1) + " 0\n";
+			}
+		}
+	}
+
+	// program binaries need GL 4.1 or ARB_get_program_binary and at least one format
+	// ------------------------------------------------------------------------
+	static bool binarySupported() {
+#ifdef SHADER_BINARY_CACHE
+		static int supported = -1;
+		if (supported < 0) {
+			bool loaded = false;
+#ifdef GL_ARB_get_program_binary
+			loaded = loaded || GLAD_GL_ARB_get_program_binary;
+#endif
+#ifdef GL_VERSION_4_1
+			loaded = loaded || GLAD_GL_VERSION_4_1;
+#endif
+			GLint formats = 0;
+			if (loaded) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			supported = formats > 0;
+		}
+		return supported != 0;
+#else
+		return false;
+#endif
+	}
+
+	// FNV-1a of both sources and of the driver identification, binaries are
+	// only valid for the driver that produced them
+	// ------------------------------------------------------------------------
+	static uint64_t cacheKey(const std::string &vertexCode, const std::string &fragmentCode) {
+		uint64_t h = 0xCBF29CE484222325ull;
+		auto mix = [&h](const char* text) {
+			for (; text != NULL && *text; ++text) h = (h ^ (unsigned char)*text) * 0x100000001B3ull;
+			h = (h ^ 0xFF) * 0x100000001B3ull;
+		};
+		mix(vertexCode.c_str());
+		mix(fragmentCode.c_str());
+		mix((const char*)glGetString(GL_VENDOR));
+		mix((const char*)glGetString(GL_RENDERER));
+		mix((const char*)glGetString(GL_VERSION));
+		return h;
+	}
+
+	static std::string cachePath(uint64_t key) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return std::string(SHADER_CACHE_DIR) + "/" + name;
+	}
+
+	// links ID from a cached binary, false if there is none or the driver rejects it
+	// ------------------------------------------------------------------------
+	bool loadBinary(uint64_t key) {
+#ifndef SHADER_BINARY_CACHE
+		(void)key;
+		return false;
+#else
+		if (!binarySupported()) return false;
+		std::string path = cachePath(key);
+		FILE* file = std::fopen(path.c_str(), "rb");
+		if (file == NULL) return false;
+		ShaderCacheHeader header;
+		std::vector<char> binary;
+		bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+			std::memcmp(header.Magic, SHADER_CACHE_MAGIC, sizeof(header.Magic)) == 0 &&
+			header.Version == SHADER_CACHE_VERSION && header.Key == key && header.Size > 0;
+		if (ok) {
+			binary.resize((size_t)header.Size);
+			ok = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+		}
+		std::fclose(file);
+		if (!ok) {
+			std::cout << "ERROR::SHADER_CACHE::INVALID_FILE: " << path << std::endl;
+			return false;
+		}
+		glProgramBinary(ID, header.Format, binary.data(), (GLsizei)binary.size());
+		GLint success = 0;
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		if (!success) std::cout << "ERROR::SHADER_CACHE::BINARY_REJECTED: " << path << std::endl;
+		return success != 0;
+#endif
+	}
+
+	// stores the binary of the linked program ID
+	// ------------------------------------------------------------------------
+	void saveBinary(uint64_t key) const {
+#ifndef SHADER_BINARY_CACHE
+		(void)key;
+#else
+		GLint success = 0, length = 0;
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		if (!success || !binarySupported()) return;
+		glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) return;
+
+		ShaderCacheHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.Magic, SHADER_CACHE_MAGIC, sizeof(header.Magic));
+		header.Version = SHADER_CACHE_VERSION;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(ID, length, &length, &format, binary.data());
+		header.Format = format;
+		header.Key = key;
+		header.Size = (uint64_t)length;
+
+		std::error_code error;
+		std::filesystem::create_directories(SHADER_CACHE_DIR, error);
+		std::string path = cachePath(key);
+		FILE* file = std::fopen(path.c_str(), "wb");
+		if (file == NULL) {
+			std::cout << "ERROR::SHADER_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+			return;
+		}
+		bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+			std::fwrite(binary.data(), 1, (size_t)length, file) == (size_t)length;
+		ok = (std::fclose(file) == 0) && ok;
+		if (!ok) {
+			std::cout << "ERROR::SHADER_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+			std::remove(path.c_str());
+		}
+#endif
+	}
+
 	// utility function for checking shader compilation/linking errors.
 	// ------------------------------------------------------------------------
-	void checkCompileErrors(GLuint shader, std::string type) {
+	void checkCompileErrors(GLuint shader, std::string type, const std::vector<std::string>* files = NULL) {
 		GLint success;
 		GLchar infoLog[1024];
 		if (type != "PROGRAM") {
 			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 			if (!success) {
 				glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-				std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+				std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog;
+				// messages are prefixed with the source string number of the file
+				for (size_t i = 0; files != NULL && i < files->size(); ++i)
+					std::cout << "  " << i << ": " << (*files)[i] << "\n";
+				std::cout << "\n -- --------------------------------------------------- -- " << std::endl;
 			}
 		}
 		else {
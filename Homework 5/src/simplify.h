@@ -0,0 +1,282 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+// Default simplifier options
+const float SIMPLIFY_MIN_NORMAL_DOT = 0.2f; // reject collapses that turn a triangle by more than ~78 degrees
+
+// Quadric error metric (Garland & Heckbert) mesh simplifier using half-edge
+// collapses: a vertex is always collapsed onto one of its neighbours, so every
+// level of detail indexes the original vertex buffer and no new vertices are
+// created.
+//
+// Vertices sharing a position but not attributes (e.g. the corners of a flat
+// shaded cube) are treated as one position with several "wedges". A position
+// may only collapse if every one of its wedges can follow along an edge, which
+// keeps attribute seams intact. Positions on an open border never move.
+//
+// The state is kept between calls, so a chain of LODs is built by calling
+// simplify() with decreasing targets.
+class Simplifier {
+public:
+	// current index buffer
+	std::vector<unsigned int> Indices;
+	// largest collapse error so far, in model space units
+	float Error;
+
+	Simplifier(const float* vertices, unsigned int vertexCount, unsigned int stride, const std::vector<unsigned int> &indices) :
+		Indices(indices), Error(0.0f)
+	{
+		weldPositions(vertices, vertexCount, stride);
+
+		// every triangle adds the quadric of its plane to its three positions
+		quadrics.assign(positions.size() / 3, Quadric());
+		for (size_t t = 0; t + 2 < Indices.size(); t += 3) {
+			unsigned int a = positionOf[Indices[t]], b = positionOf[Indices[t + 1]], c = positionOf[Indices[t + 2]];
+			Quadric q;
+			if (!planeQuadric(a, b, c, q)) continue;
+			quadrics[a].add(q);
+			quadrics[b].add(q);
+			quadrics[c].add(q);
+		}
+		lockBorders();
+	}
+
+	// Collapses edges in order of increasing error until at most targetIndexCount
+	// indices are left, or the next collapse would exceed maxError
+	void simplify(size_t targetIndexCount, float maxError = FLT_MAX) {
+		double maxCost = (double)maxError * maxError;
+		while (Indices.size() > targetIndexCount) {
+			// each collapse removes about two triangles
+			size_t wanted = (Indices.size() - targetIndexCount) / 6 + 1;
+			if (collapsePass(wanted, maxCost) == 0) break;
+		}
+	}
+
+private:
+	// Area weighted sum of plane quadrics: a symmetric 4x4 matrix stored as its
+	// upper triangle plus the total weight, so that evaluate() is the mean squared
+	// distance to the accumulated planes.
+	struct Quadric {
+		double a[10];
+		double w;
+		Quadric() : w(0.0) { std::memset(a, 0, sizeof(a)); }
+		void add(const Quadric &q) { for (int i = 0; i < 10; ++i) a[i] += q.a[i]; w += q.w; }
+		double evaluate(const float* p) const {
+			if (w == 0.0) return 0.0;
+			double x = p[0], y = p[1], z = p[2];
+			return (a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+				+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+				+ a[7] * z * z + 2 * a[8] * z
+				+ a[9]) / w;
+		}
+	};
+
+	struct Collapse {
+		unsigned int From, To;
+		double Cost;
+		bool operator<(const Collapse &other) const { return Cost < other.Cost; }
+	};
+
+	std::vector<float> positions;          // xyz per welded position
+	std::vector<unsigned int> positionOf;  // vertex -> welded position
+	std::vector<Quadric> quadrics;         // per welded position
+	std::vector<bool> locked;              // per welded position
+
+	// position -> triangles adjacency of the current index buffer
+	std::vector<unsigned int> adjacencyOffsets, adjacency;
+
+	void weldPositions(const float* vertices, unsigned int vertexCount, unsigned int stride) {
+		struct Key {
+			float x, y, z;
+			bool operator==(const Key &o) const { return x == o.x && y == o.y && z == o.z; }
+		};
+		struct KeyHash {
+			size_t operator()(const Key &k) const {
+				unsigned int h[3];
+				std::memcpy(h, &k, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}
+		};
+		std::unordered_map<Key, unsigned int, KeyHash> unique(vertexCount);
+		positionOf.resize(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; ++v) {
+			const float* p = vertices + (size_t)v * stride;
+			auto it = unique.emplace(Key{ p[0], p[1], p[2] }, (unsigned int)(positions.size() / 3));
+			if (it.second) positions.insert(positions.end(), p, p + 3);
+			positionOf[v] = it.first->second;
+		}
+	}
+
+	bool planeQuadric(unsigned int a, unsigned int b, unsigned int c, Quadric &q) const {
+		const float* pa = &positions[a * 3];
+		const float* pb = &positions[b * 3];
+		const float* pc = &positions[c * 3];
+		double e1[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+		double e2[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0.0) return false;
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		double d = -(n[0] * pa[0] + n[1] * pa[1] + n[2] * pa[2]);
+		double plane[4] = { n[0], n[1], n[2], d };
+		double area = 0.5 * length;
+		int k = 0;
+		for (int i = 0; i < 4; ++i)
+			for (int j = i; j < 4; ++j)
+				q.a[k++] = area * plane[i] * plane[j];
+		q.w = area;
+		return true;
+	}
+
+	// an edge used by a single triangle lies on an open border
+	void lockBorders() {
+		std::unordered_map<unsigned long long, int> edgeUse;
+		for (size_t t = 0; t + 2 < Indices.size(); t += 3) {
+			for (int k = 0; k < 3; ++k) {
+				unsigned long long a = positionOf[Indices[t + k]], b = positionOf[Indices[t + (k + 1) % 3]];
+				if (a > b) std::swap(a, b);
+				++edgeUse[(a << 32) | b];
+			}
+		}
+		locked.assign(quadrics.size(), false);
+		for (auto &edge : edgeUse) {
+			if (edge.second == 1) {
+				locked[edge.first >> 32] = true;
+				locked[edge.first & 0xFFFFFFFFull] = true;
+			}
+		}
+	}
+
+	void buildAdjacency() {
+		adjacencyOffsets.assign(quadrics.size() + 1, 0);
+		for (unsigned int index : Indices) ++adjacencyOffsets[positionOf[index] + 1];
+		for (size_t p = 0; p < quadrics.size(); ++p) adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+		adjacency.resize(Indices.size());
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < Indices.size(); ++i)
+			adjacency[fill[positionOf[Indices[i]]]++] = (unsigned int)(i / 3);
+	}
+
+	// Finds for every wedge of `from` the wedge of `to` it collapses onto.
+	// Fails if a wedge has no edge towards `to`, i.e. it would cross a seam.
+	bool mapWedges(unsigned int from, unsigned int to, std::vector<std::pair<unsigned int, unsigned int>> &wedges) const {
+		wedges.clear();
+		for (unsigned int i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i) {
+			const unsigned int* tri = &Indices[adjacency[i] * 3];
+			unsigned int wedge = 0, target = 0;
+			bool hasTarget = false;
+			for (int k = 0; k < 3; ++k) {
+				if (positionOf[tri[k]] == from) wedge = tri[k];
+				if (positionOf[tri[k]] == to) { target = tri[k]; hasTarget = true; }
+			}
+			bool known = false;
+			for (auto &w : wedges) {
+				if (w.first != wedge) continue;
+				known = true;
+				if (hasTarget && w.second == wedge) w.second = target;
+			}
+			if (!known) wedges.push_back(std::make_pair(wedge, hasTarget ? target : wedge));
+		}
+		for (auto &w : wedges)
+			if (w.second == w.first) return false;
+		return true;
+	}
+
+	// rejects collapses that flip or badly distort a surrounding triangle
+	bool flips(unsigned int from, unsigned int to) const {
+		const float* target = &positions[to * 3];
+		for (unsigned int i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i) {
+			const unsigned int* tri = &Indices[adjacency[i] * 3];
+			unsigned int p[3] = { positionOf[tri[0]], positionOf[tri[1]], positionOf[tri[2]] };
+			if (p[0] == to || p[1] == to || p[2] == to) continue;
+			const float* before[3], *after[3];
+			for (int k = 0; k < 3; ++k) {
+				before[k] = &positions[p[k] * 3];
+				after[k] = p[k] == from ? target : before[k];
+			}
+			double n0[3], n1[3];
+			normal(before, n0);
+			normal(after, n1);
+			double d = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+			double l = std::sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+			if (d <= SIMPLIFY_MIN_NORMAL_DOT * l) return true;
+		}
+		return false;
+	}
+
+	static void normal(const float* p[3], double n[3]) {
+		double e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+		double e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+
+	// One round of independent collapses, cheapest first. Returns the number done.
+	size_t collapsePass(size_t wanted, double maxCost) {
+		buildAdjacency();
+
+		std::vector<Collapse> candidates;
+		candidates.reserve(Indices.size() * 2);
+		for (size_t t = 0; t + 2 < Indices.size(); t += 3) {
+			for (int k = 0; k < 3; ++k) {
+				unsigned int a = positionOf[Indices[t + k]], b = positionOf[Indices[t + (k + 1) % 3]];
+				if (a == b) continue;
+				Quadric q = quadrics[a];
+				q.add(quadrics[b]);
+				if (!locked[a]) candidates.push_back({ a, b, q.evaluate(&positions[b * 3]) });
+				if (!locked[b]) candidates.push_back({ b, a, q.evaluate(&positions[a * 3]) });
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		// vertex -> vertex it collapses onto
+		std::vector<unsigned int> remap;
+		std::vector<bool> touched(quadrics.size(), false);
+		std::vector<std::pair<unsigned int, unsigned int>> wedges;
+		size_t done = 0;
+		for (const Collapse &c : candidates) {
+			if (done >= wanted || c.Cost > maxCost) break;
+			if (touched[c.From] || touched[c.To]) continue;
+			if (!mapWedges(c.From, c.To, wedges) || flips(c.From, c.To)) continue;
+
+			if (remap.empty()) {
+				remap.resize(positionOf.size());
+				for (size_t v = 0; v < remap.size(); ++v) remap[v] = (unsigned int)v;
+			}
+			for (auto &w : wedges) remap[w.first] = w.second;
+			quadrics[c.To].add(quadrics[c.From]);
+			Error = std::max(Error, (float)std::sqrt(std::max(c.Cost, 0.0)));
+
+			// the neighbourhood of a collapse must stay unchanged for the rest of the pass
+			for (unsigned int i = adjacencyOffsets[c.From]; i < adjacencyOffsets[c.From + 1]; ++i)
+				for (int k = 0; k < 3; ++k)
+					touched[positionOf[Indices[adjacency[i] * 3 + k]]] = true;
+			touched[c.To] = true;
+			++done;
+		}
+		if (done == 0) return 0;
+
+		// apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < Indices.size(); t += 3) {
+			unsigned int a = remap[Indices[t]], b = remap[Indices[t + 1]], c = remap[Indices[t + 2]];
+			unsigned int pa = positionOf[a], pb = positionOf[b], pc = positionOf[c];
+			if (pa == pb || pb == pc || pc == pa) continue;
+			Indices[write++] = a;
+			Indices[write++] = b;
+			Indices[write++] = c;
+		}
+		Indices.resize(write);
+		return done;
+	}
+};
+
+#endif // !SIMPLIFY_H
@@ -0,0 +1,135 @@
+// bvh_bench: measures BVH build time and ray traversal rate on a generated
+// mesh of about a million triangles, and optionally ray traces it on the CPU.
+//
+// usage: bvh_bench [rings] [output.ppm]
+// A bumpy sphere of rings * 2 * rings * 2 triangles is built (512 rings by
+// default, 1M triangles). With an output path the primary rays are written as
+// a shaded image.
+
+#include "../src/bvh.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+const unsigned int IMAGE_SIZE = 512;
+const unsigned int VERIFY_RAYS = 64;
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	unsigned int rings = argc > 1 ? (unsigned int)std::atoi(argv[1]) : 512;
+	std::string output = argc > 2 ? argv[2] : "";
+	unsigned int sectors = rings * 2;
+
+	// bumpy unit sphere, positions only
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	for (unsigned int r = 0; r <= rings; ++r) {
+		for (unsigned int s = 0; s <= sectors; ++s) {
+			float theta = glm::radians(180.0f * r / rings);
+			float phi = glm::radians(360.0f * s / sectors);
+			float bump = 1.0f + 0.05f * std::sin(theta * 23.0f) * std::sin(phi * 17.0f);
+			vertices.insert(vertices.end(), { bump * std::sin(theta) * std::cos(phi), bump * std::cos(theta), bump * std::sin(theta) * std::sin(phi) });
+		}
+	}
+	for (unsigned int r = 0; r < rings; ++r) {
+		for (unsigned int s = 0; s < sectors; ++s) {
+			unsigned int a = r * (sectors + 1) + s, b = a + sectors + 1;
+			indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+	size_t triangleCount = indices.size() / 3;
+	auto corner = [&](size_t triangle, int k) {
+		const float* p = &vertices[indices[triangle * 3 + k] * 3];
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	TriangleBVH bvh(vertices.data(), 3, indices.data(), indices.size());
+	double buildTime = elapsed(start);
+	std::cout << "BVH: " << triangleCount << " triangles, " << bvh.Tree.Nodes.size() << " nodes, built in "
+		<< buildTime << " ms (" << triangleCount / buildTime / 1000.0 << " Mtris/s)" << std::endl;
+
+	// primary rays of a pinhole camera looking at the sphere
+	glm::vec3 eye(0.0f, 0.5f, 3.0f);
+	glm::vec3 forward = glm::normalize(-eye), right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+	glm::vec3 up = glm::cross(right, forward);
+	auto primary = [&](unsigned int x, unsigned int y) {
+		float u = (x + 0.5f) / IMAGE_SIZE * 2.0f - 1.0f, v = 1.0f - (y + 0.5f) / IMAGE_SIZE * 2.0f;
+		return Ray(eye, forward + (right * u + up * v) * 0.5f);
+	};
+
+	std::vector<RayHit> hits(IMAGE_SIZE * IMAGE_SIZE);
+	unsigned long long visits = 0;
+	start = std::chrono::steady_clock::now();
+	for (unsigned int y = 0; y < IMAGE_SIZE; ++y) {
+		for (unsigned int x = 0; x < IMAGE_SIZE; ++x) {
+			bvh.intersect(primary(x, y), hits[y * IMAGE_SIZE + x]);
+			visits += BVH::visited();
+		}
+	}
+	double traceTime = elapsed(start);
+	std::cout << "closest hit: " << hits.size() / traceTime / 1000.0 << " Mrays/s, "
+		<< (double)visits / hits.size() << " nodes per ray" << std::endl;
+
+	// shadow rays from every hit towards a point light
+	glm::vec3 light(2.0f, 3.0f, 2.0f);
+	std::vector<bool> shadowed(hits.size(), false);
+	unsigned int shadowRays = 0;
+	start = std::chrono::steady_clock::now();
+	for (unsigned int y = 0; y < IMAGE_SIZE; ++y) {
+		for (unsigned int x = 0; x < IMAGE_SIZE; ++x) {
+			const RayHit &hit = hits[y * IMAGE_SIZE + x];
+			if (!hit.hit()) continue;
+			Ray ray = primary(x, y);
+			// start slightly above the surface
+			glm::vec3 p = ray.at(hit.T) + glm::normalize(ray.at(hit.T)) * 1e-3f;
+			shadowed[y * IMAGE_SIZE + x] = bvh.occluded(p, light);
+			++shadowRays;
+		}
+	}
+	double shadowTime = elapsed(start);
+	std::cout << "any hit: " << shadowRays / shadowTime / 1000.0 << " Mrays/s" << std::endl;
+
+	// compare a few rays against testing every triangle
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < VERIFY_RAYS; ++i) {
+		unsigned int x = (i * 97) % IMAGE_SIZE, y = (i * 131 + IMAGE_SIZE / 4) % IMAGE_SIZE;
+		Ray ray = primary(x, y);
+		float tMax = FLT_MAX, u, v;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			TriangleBVH::hitTriangle(ray, corner(t, 0), corner(t, 1), corner(t, 2), tMax, u, v);
+		}
+		if (tMax != hits[y * IMAGE_SIZE + x].T) ++mismatches;
+	}
+	std::cout << "verified " << VERIFY_RAYS << " rays against brute force, " << mismatches << " mismatches" << std::endl;
+
+	if (!output.empty()) {
+		std::ofstream file(output, std::ios::binary);
+		file << "P6\n" << IMAGE_SIZE << " " << IMAGE_SIZE << "\n255\n";
+		for (unsigned int y = 0; y < IMAGE_SIZE; ++y) {
+			for (unsigned int x = 0; x < IMAGE_SIZE; ++x) {
+				const RayHit &hit = hits[y * IMAGE_SIZE + x];
+				unsigned char shade = 40;
+				if (hit.hit()) {
+					glm::vec3 a = corner(hit.Primitive, 0), b = corner(hit.Primitive, 1), c = corner(hit.Primitive, 2);
+					glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+					glm::vec3 p = primary(x, y).at(hit.T);
+					float diffuse = std::fmax(glm::dot(normal, glm::normalize(light - p)), 0.0f);
+					if (shadowed[y * IMAGE_SIZE + x]) diffuse = 0.0f;
+					shade = (unsigned char)(60 + 195 * diffuse);
+				}
+				unsigned char rgb[3] = { shade, shade, shade };
+				file.write((const char*)rgb, 3);
+			}
+		}
+		std::cout << "wrote " << output << std::endl;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+// per-frame data shared by all programs, must match uniform_block.h
+layout (std140) uniform Camera {
+	mat4 proj;
+	mat4 view;
+	vec3 viewPos;
+};
+
+layout (std140) uniform Light {
+	mat4 lightSpaceMatrix;
+	vec3 lightPos;
+	vec3 lightColor;
+};
\ No newline at end of file
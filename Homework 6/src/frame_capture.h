@@ -0,0 +1,332 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+#include "gl_resources.h"
+
+// Default capture options
+const unsigned int CAPTURE_BUFFERS = 3; // pixel buffers frames are read into, at least 3
+
+// File formats of captured frames
+enum CaptureFormat {
+	CAPTURE_PNG, // uncompressed, see writePNG()
+	CAPTURE_RAW  // RGBA rows top to bottom without a header, the size is in the file name
+};
+
+// Writes the frames of a run to image files without stalling the GPU.
+//
+// glReadPixels into a pixel buffer object returns immediately; a fence tells
+// when the copy has finished, frames later. The buffer is then mapped and the
+// pointer handed to a writer thread, which encodes the file straight from the
+// mapped memory and gives the buffer back. With all buffers busy (the writer
+// falls behind) frames are dropped and counted instead of waiting.
+//
+// Command line options, consumed from the arguments:
+//   --capture DIR    write every frame to DIR/frame_NNNNN.png
+//   --raw            write raw RGBA instead of PNG
+class FrameCapture {
+public:
+	bool Enabled;
+	unsigned int Captured; // frames written
+	unsigned int Dropped;  // frames skipped because every buffer was busy
+
+	FrameCapture(std::vector<std::string> &arguments, unsigned int width, unsigned int height) :
+		Enabled(false), Captured(0), Dropped(0), format(CAPTURE_PNG), width(width), height(height), frame(0), stopping(false) {
+		for (size_t i = 0; i < arguments.size();) {
+			if (arguments[i] == "--capture" && i + 1 < arguments.size()) {
+				Enabled = true;
+				directory = arguments[i + 1];
+				arguments.erase(arguments.begin() + i, arguments.begin() + i + 2);
+			}
+			else if (arguments[i] == "--raw") {
+				format = CAPTURE_RAW;
+				arguments.erase(arguments.begin() + i);
+			}
+			else ++i;
+		}
+		if (!Enabled) return;
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		GLResources &resources = GLResources::get();
+		for (Slot &slot : slots) {
+			slot.Buffer = resources.createBuffer();
+			slot.PBO = resources.name(slot.Buffer);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+			glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+			resources.setMemory(slot.Buffer, (size_t)width * height * 4);
+			slot.Fence = 0;
+			slot.Pixels = NULL;
+			slot.State = SLOT_FREE;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		writer = std::thread(&FrameCapture::run, this);
+	}
+
+	~FrameCapture() {
+		release();
+	}
+
+	// Reads the bound read framebuffer, call once the frame is drawn. Also
+	// hands finished reads to the writer and recycles written buffers.
+	void capture() {
+		if (!Enabled) return;
+		collect(false);
+		Slot* free = NULL;
+		for (unsigned int i = 0; i < CAPTURE_BUFFERS && free == NULL; ++i) {
+			Slot &slot = slots[(frame + i) % CAPTURE_BUFFERS];
+			if (slot.State.load(std::memory_order_acquire) == SLOT_FREE) free = &slot;
+		}
+		unsigned int number = frame++;
+		if (free == NULL) {
+			++Dropped;
+			return;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, free->PBO);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		free->Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		free->Frame = number;
+		free->State.store(SLOT_READING, std::memory_order_relaxed);
+	}
+
+	// writes the frames still in flight and stops the writer, must be called
+	// while the context is alive
+	void release() {
+		if (!Enabled) return;
+		// wait for the last reads and writes
+		for (bool busy = true; busy;) {
+			collect(true);
+			busy = false;
+			for (Slot &slot : slots)
+				if (slot.State.load(std::memory_order_acquire) != SLOT_FREE) busy = true;
+			if (busy) std::this_thread::yield();
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		writer.join();
+		for (Slot &slot : slots) {
+			GLResources::get().destroy(slot.Buffer);
+			slot.PBO = 0;
+		}
+		std::cout << "CAPTURE::" << Captured << " frames written to " << directory.string() << ", " << Dropped << " dropped" << std::endl;
+		Enabled = false;
+	}
+
+	// Writes RGBA pixels, rows bottom to top as read from GL, as a PNG. The
+	// image data is stored uncompressed in deflate blocks: files are large but
+	// encoding costs no more than a copy, which keeps up with the frame rate.
+	static bool writePNG(const std::string &path, const unsigned char* pixels, unsigned int width, unsigned int height) {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) return false;
+		const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		file.write((const char*)signature, 8);
+
+		unsigned char header[13];
+		putBigEndian(header, width);
+		putBigEndian(header + 4, height);
+		header[8] = 8;  // bits per channel
+		header[9] = 6;  // RGBA
+		header[10] = header[11] = header[12] = 0;
+		writeChunk(file, "IHDR", header, 13);
+
+		// zlib stream: rows with filter type 0, flipped to top to bottom
+		size_t rowSize = (size_t)width * 4 + 1;
+		std::vector<unsigned char> rows(rowSize * height);
+		for (unsigned int y = 0; y < height; ++y) {
+			unsigned char* row = &rows[rowSize * y];
+			row[0] = 0;
+			std::memcpy(row + 1, pixels + (size_t)width * 4 * (height - 1 - y), rowSize - 1);
+		}
+		std::vector<unsigned char> data;
+		data.reserve(rows.size() + rows.size() / 65535 * 5 + 16);
+		data.push_back(0x78);
+		data.push_back(0x01);
+		for (size_t offset = 0; offset < rows.size() || offset == 0;) {
+			size_t length = std::min(rows.size() - offset, (size_t)65535);
+			bool last = offset + length == rows.size();
+			data.push_back(last ? 1 : 0);
+			data.push_back((unsigned char)(length & 0xFF));
+			data.push_back((unsigned char)(length >> 8));
+			data.push_back((unsigned char)(~length & 0xFF));
+			data.push_back((unsigned char)((~length >> 8) & 0xFF));
+			data.insert(data.end(), rows.begin() + offset, rows.begin() + offset + length);
+			offset += length;
+			if (last) break;
+		}
+		unsigned char adler[4];
+		putBigEndian(adler, adler32(rows.data(), rows.size()));
+		data.insert(data.end(), adler, adler + 4);
+		writeChunk(file, "IDAT", data.data(), data.size());
+		writeChunk(file, "IEND", NULL, 0);
+		return (bool)file;
+	}
+
+private:
+	enum SlotState {
+		SLOT_FREE,    // ready for the next read
+		SLOT_READING, // GPU copies the frame, Fence is set
+		SLOT_MAPPED,  // writer encodes from Pixels
+		SLOT_WRITTEN  // writer done, to be unmapped
+	};
+
+	struct Slot {
+		GLuint PBO;
+		BufferHandle Buffer; // PBO in the GLResources pool
+		GLsync Fence;
+		const unsigned char* Pixels;
+		unsigned int Frame;
+		std::atomic<int> State;
+	};
+
+	CaptureFormat format;
+	std::filesystem::path directory;
+	unsigned int width, height;
+	unsigned int frame;
+	Slot slots[CAPTURE_BUFFERS];
+	// writer thread and its queue
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Slot*> queue;
+	bool stopping;
+
+	// on the GL thread: unmaps written buffers and maps finished reads
+	void collect(bool wait) {
+		for (Slot &slot : slots) {
+			int state = slot.State.load(std::memory_order_acquire);
+			if (state == SLOT_WRITTEN) {
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				slot.Pixels = NULL;
+				slot.State.store(SLOT_FREE, std::memory_order_release);
+				++Captured;
+			}
+			else if (state == SLOT_READING) {
+				GLenum status = glClientWaitSync(slot.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+				if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+				glDeleteSync(slot.Fence);
+				slot.Fence = 0;
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+				slot.Pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+				if (slot.Pixels == NULL) {
+					std::cout << "ERROR::CAPTURE::MAP_FAILED: frame " << slot.Frame << std::endl;
+					slot.State.store(SLOT_FREE, std::memory_order_release);
+					continue;
+				}
+				slot.State.store(SLOT_MAPPED, std::memory_order_release);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					queue.push_back(&slot);
+				}
+				wake.notify_one();
+			}
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	void run() {
+		for (;;) {
+			Slot* slot;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || !queue.empty(); });
+				if (queue.empty()) break;
+				slot = queue.front();
+				queue.pop_front();
+			}
+			char name[64];
+			bool written;
+			if (format == CAPTURE_PNG) {
+				std::snprintf(name, sizeof(name), "frame_%05u.png", slot->Frame);
+				written = writePNG((directory / name).string(), slot->Pixels, width, height);
+			}
+			else {
+				std::snprintf(name, sizeof(name), "frame_%05u_%ux%u.rgba", slot->Frame, width, height);
+				written = writeRaw((directory / name).string(), slot->Pixels);
+			}
+			if (!written) std::cout << "ERROR::CAPTURE::FILE_NOT_WRITTEN: " << name << std::endl;
+			slot->State.store(SLOT_WRITTEN, std::memory_order_release);
+		}
+	}
+
+	bool writeRaw(const std::string &path, const unsigned char* pixels) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) return false;
+		size_t rowSize = (size_t)width * 4;
+		for (unsigned int y = height; y-- > 0;)
+			file.write((const char*)pixels + rowSize * y, rowSize);
+		return (bool)file;
+	}
+
+	static void putBigEndian(unsigned char* out, uint32_t value) {
+		out[0] = (unsigned char)(value >> 24);
+		out[1] = (unsigned char)(value >> 16);
+		out[2] = (unsigned char)(value >> 8);
+		out[3] = (unsigned char)value;
+	}
+
+	static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size) {
+		static const std::vector<uint32_t> table = [] {
+			std::vector<uint32_t> entries(256);
+			for (uint32_t n = 0; n < 256; ++n) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				entries[n] = c;
+			}
+			return entries;
+		}();
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+	static uint32_t adler32(const unsigned char* data, size_t size) {
+		uint32_t a = 1, b = 0;
+		// 5552 bytes is the longest run before the sums can overflow
+		for (size_t start = 0; start < size; start += 5552) {
+			size_t end = std::min(size, start + 5552);
+			for (size_t i = start; i < end; ++i) {
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	static void writeChunk(std::ofstream &file, const char* type, const unsigned char* data, size_t size) {
+		unsigned char length[4];
+		putBigEndian(length, (uint32_t)size);
+		file.write((const char*)length, 4);
+		file.write(type, 4);
+		if (size > 0) file.write((const char*)data, size);
+		uint32_t crc = crc32(0xFFFFFFFFu, (const unsigned char*)type, 4);
+		crc = crc32(crc, data, size) ^ 0xFFFFFFFFu;
+		unsigned char footer[4];
+		putBigEndian(footer, crc);
+		file.write((const char*)footer, 4);
+	}
+};
+
+#endif // !FRAME_CAPTURE_H
@@ -1,9 +1,9 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
+#include "blocks.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
 
 void main()
 {
@@ -0,0 +1,27 @@
+// Phong reflection model shared by Phong and Gouraud shading
+#include "blocks.glsl"
+
+uniform float Ka;
+uniform float Kd;
+uniform float Ks;
+uniform int nSpec;
+
+// ambient, diffuse and specular light reaching the eye from a surface point
+vec3 phongLighting(vec3 position, vec3 normal) {
+	// ambient
+	vec3 ambient = Ka * lightColor;
+
+	// diffuse
+	vec3  norm = normalize(normal);
+	vec3  lightDir = normalize(lightPos - position);
+	float arc_diff = max(dot(norm, lightDir), 0.0);
+	vec3  diffuse = arc_diff * lightColor;
+
+	// specular
+	vec3 viewDir = normalize(viewPos - position);
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float arc_spec = pow(max(dot(viewDir, reflectDir), 0.0), nSpec);
+	vec3 specular = Ks * arc_spec * lightColor;
+
+	return ambient + Kd * diffuse + specular;
+}
\ No newline at end of file
@@ -11,6 +11,15 @@
 
 #include "shader.h"
 #include "camera.h"
+#include "mesh.h"
+#include "gl_state.h"
+#include "gl_resources.h"
+#include "timestep.h"
+#include "uniform_block.h"
+#include "shader_compiler.h"
+#include "shader_watcher.h"
+#include "headless.h"
+#include "frame_capture.h"
 
 #include <iostream>
 
@@ -39,12 +48,28 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main() {
+// uniforms of the shading programs set every frame, resolved once per linked program
+struct ShadingUniforms {
+	UniformHandle ObjectColor, Ka, Kd, Ks, NSpec, Model;
+
+	void resolve(const Shader &shader) {
+		ObjectColor = shader.handle("objectColor");
+		Ka = shader.handle("Ka");
+		Kd = shader.handle("Kd");
+		Ks = shader.handle("Ks");
+		NSpec = shader.handle("nSpec");
+		Model = shader.handle("model");
+	}
+};
+
+int main(int argc, char* argv[]) {
 	//----------------------------------------------------------------
 	// Initialize and configure GLFW
 	// Version: 3.3
 	// Profile: CORE
-	glfwInit();
+	// --headless renders offscreen without a display, see headless.h
+	Headless headless(argc, argv, WIDTH, HEIGHT);
+	headless.init();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -52,7 +77,7 @@ int main() {
 	// Create GLFW window
 	// Width:  800
 	// Height: 600
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "HW6", NULL, NULL);
+	GLFWwindow* window = headless.createWindow(WIDTH, HEIGHT, "HW6");
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window." << std::endl;
 		glfwTerminate();
@@ -69,6 +94,19 @@ int main() {
 		return -1;
 	}
 
+	// every GL object lives in pools that count it, deleted ones are dropped
+	// from the state cache
+	GLResources &resources = GLResources::get();
+	resources.OnDelete = [](GLResourceType type, GLuint name) { GLState::get().forget(type, name); };
+
+	// offscreen framebuffer of the headless mode
+	if (!headless.setup()) {
+		glfwTerminate();
+		return -1;
+	}
+	// --capture DIR writes every frame to DIR, see frame_capture.h
+	FrameCapture capture(headless.Arguments, headless.width(), headless.height());
+
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// Setup ImGui Context
@@ -87,14 +125,37 @@ int main() {
 	// configure global opengl states
 	glEnable(GL_DEPTH_TEST);
 
+	// submit all programs up front, they compile while the first frames are shown
+	ShaderCompiler compiler(window);
+	// saving a shader file rebuilds the programs using it while the app keeps running
+	ShaderWatcher watcher(compiler);
+
 	// build and compile Phong shading program
-	Shader phongShader("phong.vs", "phong.fs");
+	Shader phongShader("phong.vs", "phong.fs", true);
+	compiler.submit(phongShader);
 
 	// build and compile Gouraud shading program
-	Shader gouraudShader("gouraud.vs", "gouraud.fs");
+	Shader gouraudShader("gouraud.vs", "gouraud.fs", true);
+	compiler.submit(gouraudShader);
 
 	// build and compile lamp shader
-	Shader lampShader("lamp.vs", "lamp.fs");
+	Shader lampShader("lamp.vs", "lamp.fs", true);
+	compiler.submit(lampShader);
+
+	bool shadersReady = false;
+	float firstFrameTime = -1.0f;
+	ShadingUniforms phongUniforms, gouraudUniforms;
+	UniformHandle lampModel;
+	// again whenever the watcher swaps in a rebuilt program
+	auto resolveUniforms = [&]() {
+		phongUniforms.resolve(phongShader);
+		gouraudUniforms.resolve(gouraudShader);
+		lampModel = lampShader.handle("model");
+	};
+
+	// per-frame camera and light data, shared by the three programs
+	UniformBlock<CameraBlock> cameraBlock(CAMERA_BINDING);
+	UniformBlock<LightBlock> lightBlock(LIGHT_BINDING);
 
 	// cube vertices 
 	float vertices[] = {
@@ -141,38 +202,10 @@ int main() {
 		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
 	};
 	
-	// cube object
+	// cube object, also used for the lamp (the lamp shader only reads positions)
 	// ----
-	unsigned int VAO, VBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glBindVertexArray(VAO);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
-	// lamp object
-	// -----------
-	unsigned int lampVAO, lampVBO;
-	glGenVertexArrays(1, &lampVAO);
-	glGenBuffers(1, &lampVBO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, lampVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glBindVertexArray(lampVAO);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	Mesh cube(vertices, sizeof(vertices) / sizeof(float), { 3, 3 });
+	cube.printStats("cube");
 
 	// shading type:
 	// 0 - Phong shading
@@ -189,14 +222,62 @@ int main() {
 	// auto light moving
 	bool autoLightMoving = false;
 
+	// the lamp is moved by a fixed-step simulation, rendering interpolates
+	// between the lamp positions of the last two ticks
+	FixedTimestep timestep;
+	glm::vec3 prevLightPos = lightPos;
+
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(window)) {
+		headless.beginFrame();
 		// frame time
 		float current = glfwGetTime();
 		deltaTime = current - lastFrame;
 		lastFrame = current;
 
+		// finish background compiles and reloads, present empty frames until
+		// every program is ready
+		bool compiled = compiler.poll();
+		if (watcher.update() > 0) resolveUniforms();
+		if (!shadersReady) {
+			if (!compiled) {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glfwSwapBuffers(window);
+				glfwPollEvents();
+				if (firstFrameTime < 0.0f) firstFrameTime = glfwGetTime();
+				continue;
+			}
+			shadersReady = true;
+			auto configure = [&](Shader &program) {
+				cameraBlock.bind(program, "Camera");
+				lightBlock.bind(program, "Light");
+			};
+			for (Shader* s : { &phongShader, &gouraudShader, &lampShader }) {
+				configure(*s);
+				watcher.watch(*s, configure);
+			}
+			resolveUniforms();
+			// the first run compiles and fills the binary cache, later runs load from it
+			phongShader.printStats("phong");
+			gouraudShader.printStats("gouraud");
+			lampShader.printStats("lamp");
+			// without a frame shown yet, this frame is the first one
+			if (firstFrameTime < 0.0f) firstFrameTime = glfwGetTime();
+			std::cout << "SHADER::ready after " << glfwGetTime() * 1000.0 << " ms, first frame after "
+				<< firstFrameTime * 1000.0f << " ms (" << (compiler.Parallel ? "parallel compile" : "compile thread") << ")" << std::endl;
+		}
+
+		// simulation
+		int steps = timestep.advance(current);
+		for (int i = 0; i < steps; ++i) {
+			prevLightPos = lightPos;
+			if (autoLightMoving) {
+				lightPos.x = 1.2f + sin(timestep.SimTime);
+			}
+		}
+		glm::vec3 renderLightPos = timestep.interpolate(prevLightPos, lightPos);
+
 		// input
 		processInput(window);
 
@@ -228,80 +309,92 @@ int main() {
 		ImGui::SliderInt("nSpecular", &nSpec, 1, 128);
 		
 		ImGui::Checkbox("Auto Light Moving", &autoLightMoving);
+
+		// uniform calls of the previous frame
+		UniformStats uniformStats = Shader::stats();
+		Shader::resetStats();
+		ImGui::Text("Uniform calls: %u issued, %u skipped", uniformStats.Issued, uniformStats.Skipped);
+		ImGui::Text("Shader reloads: %u (%u failed), last %.1f ms", watcher.Reloads, watcher.Failures, watcher.LastLatency);
 		ImGui::End();
 
-		glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+		glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom), (float)headless.width() / (float)headless.height(), 0.1f, 100.0f);
 		glm::mat4 view = camera.getViewMatrix();
 		glm::mat4 model = glm::mat4(1.0f);
 		//model = glm::rotate(model, glm::radians(15.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
+		cameraBlock.Data.Proj = proj;
+		cameraBlock.Data.View = view;
+		cameraBlock.Data.ViewPos = glm::vec4(camera.Position, 1.0f);
+		cameraBlock.upload();
+		lightBlock.Data.LightPos = glm::vec4(renderLightPos, 1.0f);
+		lightBlock.Data.LightColor = glm::vec4(1.0f);
+		lightBlock.upload();
+
 		if (shadingType == 0) {
 			phongShader.use();
-			phongShader.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
-			phongShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-			phongShader.setVec3("lightPos", lightPos);
-			phongShader.setVec3("viewPos", camera.Position);
-
-			phongShader.setFloat("Ka", Ka);
-			phongShader.setFloat("Kd", Kd);
-			phongShader.setFloat("Ks", Ks);
-			phongShader.setInt("nSpec", nSpec);
-
-			phongShader.setMat4("proj", proj);
-			phongShader.setMat4("view", view);
-			phongShader.setMat4("model", model);
+			phongShader.set(phongUniforms.ObjectColor, glm::vec3(1.0f, 0.5f, 0.31f));
+
+			phongShader.set(phongUniforms.Ka, Ka);
+			phongShader.set(phongUniforms.Kd, Kd);
+			phongShader.set(phongUniforms.Ks, Ks);
+			phongShader.set(phongUniforms.NSpec, nSpec);
+
+			phongShader.set(phongUniforms.Model, model);
 		}
 		else {
 			gouraudShader.use();
-			gouraudShader.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
-			gouraudShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-			gouraudShader.setVec3("lightPos", lightPos);
-			gouraudShader.setVec3("viewPos", camera.Position);
-
-			gouraudShader.setFloat("Ka", Ka);
-			gouraudShader.setFloat("Kd", Kd);
-			gouraudShader.setFloat("Ks", Ks);
-			gouraudShader.setInt("nSpec", nSpec);
-
-			gouraudShader.setMat4("proj", proj);
-			gouraudShader.setMat4("view", view);
-			gouraudShader.setMat4("model", model);
+			gouraudShader.set(gouraudUniforms.ObjectColor, glm::vec3(1.0f, 0.5f, 0.31f));
+
+			gouraudShader.set(gouraudUniforms.Ka, Ka);
+			gouraudShader.set(gouraudUniforms.Kd, Kd);
+			gouraudShader.set(gouraudUniforms.Ks, Ks);
+			gouraudShader.set(gouraudUniforms.NSpec, nSpec);
+
+			gouraudShader.set(gouraudUniforms.Model, model);
 		}
 		
 		// render the cube
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
-		if (autoLightMoving) {
-			lightPos.x = 1.2f + sin(glfwGetTime());
-		}
+		cube.draw();
 
 		lampShader.use();
 		model = glm::mat4(1.0f);
-		model = glm::translate(model, lightPos);
+		model = glm::translate(model, renderLightPos);
 		model = glm::scale(model, glm::vec3(0.2f));
-		lampShader.setMat4("proj", proj);
-		lampShader.setMat4("view", view);
-		lampShader.setMat4("model", model);
+		lampShader.set(lampModel, model);
 
 		// render lamp object
-		glBindVertexArray(lampVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		cube.draw();
+
+		// read the frame back before the UI is drawn over it
+		capture.capture();
 
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// the ImGui renderer binds its own objects behind the cache's back
+		GLState::get().invalidate();
+
+		resources.endFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		headless.endFrame(window);
 	}
 
 	// cleanup
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteVertexArrays(1, &lampVAO);
-	glDeleteBuffers(1, &lampVBO);
+	cube.release();
+	cameraBlock.release();
+	lightBlock.release();
+	compiler.release();
+	watcher.release();
+	phongShader.release();
+	gouraudShader.release();
+	lampShader.release();
+	capture.release();
+	headless.release();
+	// anything still alive now is reported as a leak
+	resources.release();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -311,7 +404,7 @@ int main() {
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
 }
 
 // keyboard input event callback
@@ -6,9 +6,9 @@ layout (location = 1) in vec3 aNormal;
 out vec3 FragPos;
 out vec3 Normal;
 
+#include "blocks.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
 
 void main() {
 	FragPos = vec3(model * vec4(aPos, 1.0));
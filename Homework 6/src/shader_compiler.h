@@ -0,0 +1,153 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <iostream>
+
+#include "shader.h"
+
+// Compiles deferred shaders while the application keeps rendering frames.
+//
+// With KHR_parallel_shader_compile (or the ARB variant) the driver compiles on
+// its own threads: submit() issues compile and link at once and poll() asks
+// for GL_COMPLETION_STATUS_KHR. Without it, in the driver or in glad (a plain
+// 3.3 core glad lacks both), a worker thread owning a hidden context shared
+// with the window compiles the queued shaders one by one.
+// In both cases poll() finishes completed shaders on the render thread, so
+// they become Ready there and nothing blocks the frame.
+class ShaderCompiler {
+public:
+	bool Parallel; // driver side parallel compile is used
+
+	ShaderCompiler(GLFWwindow* window) : Parallel(false), context(NULL), stopping(false) {
+#ifdef GL_KHR_parallel_shader_compile
+		if (GLAD_GL_KHR_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+			Parallel = true;
+			return;
+		}
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+		if (GLAD_GL_ARB_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+			Parallel = true;
+			return;
+		}
+#endif
+		// window hints are global, restore the default visibility afterwards
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		context = glfwCreateWindow(1, 1, "shader compiler", NULL, window);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+		if (context == NULL) {
+			std::cout << "ERROR::SHADER_COMPILER::SHARED_CONTEXT_NOT_CREATED, compiling on the render thread" << std::endl;
+			return;
+		}
+		worker = std::thread(&ShaderCompiler::run, this);
+	}
+
+	~ShaderCompiler() {
+		release();
+	}
+
+	// stops the worker and destroys its context, must be called before glfwTerminate
+	void release() {
+		if (worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_one();
+			worker.join();
+		}
+		if (context != NULL) glfwDestroyWindow(context);
+		context = NULL;
+	}
+
+	// queues a deferred shader, the shader must outlive the compiler or be finished
+	void submit(Shader &shader) {
+		if (shader.Ready) return;
+		jobs.push_back(std::unique_ptr<Job>(new Job(&shader)));
+		Job* job = jobs.back().get();
+		if (Parallel) {
+			shader.compile();
+		}
+		else if (worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				queue.push_back(job);
+			}
+			wake.notify_one();
+		}
+		else {
+			shader.compile();
+			job->Done = true;
+		}
+	}
+
+	// Finishes every shader whose compile has completed, returns true once all
+	// submitted shaders are Ready. Never waits for the driver or the worker.
+	bool poll() {
+		for (size_t i = 0; i < jobs.size();) {
+			Job &job = *jobs[i];
+			bool done = Parallel ? job.Target->linked() : job.Done.load(std::memory_order_acquire);
+			if (!done) {
+				++i;
+				continue;
+			}
+			job.Target->finish();
+			jobs[i] = std::move(jobs.back());
+			jobs.pop_back();
+		}
+		return jobs.empty();
+	}
+
+	unsigned int pendingNum() const {
+		return (unsigned int)jobs.size();
+	}
+
+private:
+	struct Job {
+		Shader* Target;
+		std::atomic<bool> Done;
+		Job(Shader* target) : Target(target), Done(false) {}
+	};
+
+	std::vector<std::unique_ptr<Job>> jobs;
+	// worker thread and its queue
+	GLFWwindow* context;
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job*> queue;
+	bool stopping;
+
+	void run() {
+		glfwMakeContextCurrent(context);
+		for (;;) {
+			Job* job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || !queue.empty(); });
+				if (stopping) break;
+				job = queue.front();
+				queue.pop_front();
+			}
+			job->Target->compile();
+			// the objects are only complete for other contexts after a finish
+			glFinish();
+			job->Done.store(true, std::memory_order_release);
+		}
+		glfwMakeContextCurrent(NULL);
+	}
+};
+
+#endif // !SHADER_COMPILER_H
@@ -0,0 +1,205 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "shader.h"
+#include "shader_compiler.h"
+
+// Default watcher options
+const double SHADER_WATCH_POLL_INTERVAL = 0.25; // seconds between file time checks without inotify
+
+// Rebuilds watched programs when one of their files (includes too) is saved.
+//
+// Changes are reported by inotify on Linux, elsewhere the modification times
+// are polled. The new program is compiled in the background by the
+// ShaderCompiler; once it is ready update() swaps it into the watched Shader
+// object between two frames, so every reference to the Shader keeps working.
+// A program that fails to compile or link is dropped and the old one stays.
+class ShaderWatcher {
+public:
+	unsigned int Reloads;  // programs swapped in
+	unsigned int Failures; // rebuilds rejected because of errors
+	double LastLatency;    // milliseconds from noticing a change to the swap
+
+	ShaderWatcher(ShaderCompiler &compiler) : Reloads(0), Failures(0), LastLatency(0.0), compiler(compiler), fd(-1) {
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0) std::cout << "ERROR::SHADER_WATCHER::INOTIFY_NOT_AVAILABLE, polling file times" << std::endl;
+#endif
+		lastPoll = std::chrono::steady_clock::now();
+	}
+
+	~ShaderWatcher() {
+		release();
+	}
+
+	// Watches the files of a ready shader. `configure` is applied to every
+	// rebuilt program before it replaces the old one (uniform blocks, samplers).
+	void watch(Shader &shader, std::function<void(Shader &)> configure = nullptr) {
+		for (const Watched &watched : programs)
+			if (watched.Target == &shader) return;
+		Watched watched;
+		watched.Target = &shader;
+		watched.Configure = configure;
+		watched.Dirty = false;
+		track(watched);
+		programs.push_back(std::move(watched));
+	}
+
+	// Call once per frame on the render thread: starts rebuilds for changed
+	// files and swaps in the programs that finished. Returns the number of
+	// programs replaced.
+	unsigned int update() {
+		detectChanges();
+		unsigned int swapped = 0;
+		for (Watched &watched : programs) {
+			if (watched.Pending && watched.Pending->Ready) {
+				if (watched.Pending->Valid) {
+					if (watched.Configure) watched.Configure(*watched.Pending);
+					std::swap(*watched.Target, *watched.Pending);
+					// the new sources may include other files
+					track(watched);
+					++Reloads;
+					++swapped;
+					LastLatency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - watched.Changed).count();
+					std::cout << "SHADER::reloaded after " << watched.ChangedFile.string() << " changed, in " << LastLatency << " ms" << std::endl;
+				}
+				else {
+					++Failures;
+					std::cout << "ERROR::SHADER_WATCHER::RELOAD_FAILED, keeping the previous program" << std::endl;
+				}
+				// after the swap Pending holds the replaced program
+				watched.Pending->release();
+				watched.Pending.reset();
+			}
+			// files saved again while compiling are picked up by the next rebuild
+			if (watched.Dirty && !watched.Pending) {
+				watched.Dirty = false;
+				watched.Changed = std::chrono::steady_clock::now();
+				watched.Pending = watched.Target->rebuild();
+				compiler.submit(*watched.Pending);
+			}
+		}
+		return swapped;
+	}
+
+	// stops watching and drops the rebuilds in flight, which must not be
+	// pending in the compiler any more
+	void release() {
+		for (Watched &watched : programs) {
+			if (!watched.Pending) continue;
+			watched.Pending->release();
+			watched.Pending.reset();
+		}
+#ifdef __linux__
+		if (fd >= 0) close(fd);
+#endif
+		fd = -1;
+		directories.clear();
+	}
+
+private:
+	struct Watched {
+		Shader* Target;
+		std::function<void(Shader &)> Configure;
+		std::vector<std::filesystem::path> Files;
+		std::vector<std::filesystem::file_time_type> Times;
+		std::unique_ptr<Shader> Pending; // rebuild in flight
+		std::chrono::steady_clock::time_point Changed;
+		std::filesystem::path ChangedFile;
+		bool Dirty;
+	};
+
+	struct Directory {
+		std::filesystem::path Path;
+		int Watch;
+	};
+
+	ShaderCompiler &compiler;
+	std::vector<Watched> programs;
+	std::vector<Directory> directories;
+	std::chrono::steady_clock::time_point lastPoll;
+	int fd;
+
+	// (re)collects the files a watched program is built from
+	void track(Watched &watched) {
+		watched.Files.clear();
+		watched.Times.clear();
+		for (const std::string &file : watched.Target->sourceFiles()) {
+			std::filesystem::path path = std::filesystem::path(file).lexically_normal();
+			watched.Files.push_back(path);
+			std::error_code error;
+			watched.Times.push_back(std::filesystem::last_write_time(path, error));
+			addDirectory(path.parent_path());
+		}
+	}
+
+	void addDirectory(const std::filesystem::path &path) {
+		for (const Directory &directory : directories)
+			if (directory.Path == path) return;
+		int watch = -1;
+#ifdef __linux__
+		// editors either rewrite a file or replace it with a renamed temporary
+		if (fd >= 0) watch = inotify_add_watch(fd, path.empty() ? "." : path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+#endif
+		directories.push_back({ path, watch });
+	}
+
+	void markChanged(const std::filesystem::path &file) {
+		for (Watched &watched : programs)
+			for (const std::filesystem::path &path : watched.Files)
+				if (path == file) {
+					watched.Dirty = true;
+					watched.ChangedFile = file;
+				}
+	}
+
+	void detectChanges() {
+#ifdef __linux__
+		if (fd >= 0) {
+			alignas(inotify_event) char buffer[4096];
+			for (;;) {
+				ssize_t length = read(fd, buffer, sizeof(buffer));
+				if (length <= 0) break;
+				for (ssize_t offset = 0; offset < length;) {
+					const inotify_event* event = (const inotify_event*)(buffer + offset);
+					offset += sizeof(inotify_event) + event->len;
+					if (event->len == 0) continue;
+					for (const Directory &directory : directories)
+						if (directory.Watch == event->wd)
+							markChanged((directory.Path / event->name).lexically_normal());
+				}
+			}
+			return;
+		}
+#endif
+		// no notifications, compare modification times a few times per second
+		auto now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<double>(now - lastPoll).count() < SHADER_WATCH_POLL_INTERVAL) return;
+		lastPoll = now;
+		for (Watched &watched : programs) {
+			for (size_t i = 0; i < watched.Files.size(); ++i) {
+				std::error_code error;
+				std::filesystem::file_time_type time = std::filesystem::last_write_time(watched.Files[i], error);
+				if (error || time == watched.Times[i]) continue;
+				watched.Times[i] = time;
+				watched.Dirty = true;
+				watched.ChangedFile = watched.Files[i];
+			}
+		}
+	}
+};
+
+#endif // !SHADER_WATCHER_H
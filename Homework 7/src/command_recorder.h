@@ -0,0 +1,109 @@
+#ifndef COMMAND_RECORDER_H
+#define COMMAND_RECORDER_H
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "render_queue.h"
+
+// Records draw packets on worker threads while the render thread does other
+// work, e.g. building the UI. Every job fills its own RenderQueue, used as a
+// command buffer, so the workers never share data; gather() merges the buffers
+// in job order on the render thread, which alone talks to GL.
+//
+// Jobs may read meshes and shaders but must not call GL or create GL objects.
+class CommandRecorder {
+public:
+	// `threadNum` 0 leaves one core to the render thread
+	CommandRecorder(unsigned int threadNum = 0) : next(0), remaining(0), stopping(false) {
+		if (threadNum == 0) threadNum = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		for (unsigned int i = 0; i < threadNum; ++i)
+			workers.emplace_back(&CommandRecorder::run, this);
+	}
+
+	~CommandRecorder() {
+		release();
+	}
+
+	// starts a job right away on the next free worker
+	void record(std::function<void(RenderQueue &)> job) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (jobs.size() == buffers.size()) buffers.emplace_back(new RenderQueue());
+		RenderQueue &buffer = *buffers[jobs.size()];
+		buffer.clear();
+		if (workers.empty()) {
+			// released, record on the calling thread
+			jobs.push_back(nullptr);
+			lock.unlock();
+			job(buffer);
+			return;
+		}
+		jobs.push_back(std::move(job));
+		++remaining;
+		wake.notify_one();
+	}
+
+	// waits for the jobs of this frame and appends their packets to `queue`
+	void gather(RenderQueue &queue) {
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return remaining == 0; });
+		for (size_t i = 0; i < jobs.size(); ++i)
+			queue.append(*buffers[i]);
+		jobs.clear();
+		next = 0;
+	}
+
+	unsigned int threadNum() const {
+		return (unsigned int)workers.size();
+	}
+
+	// stops the workers after gather(), later jobs are recorded on the calling thread
+	void release() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread &worker : workers)
+			worker.join();
+		workers.clear();
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	// jobs of the current frame and the buffer of each
+	std::vector<std::function<void(RenderQueue &)>> jobs;
+	std::vector<std::unique_ptr<RenderQueue>> buffers;
+	size_t next;
+	size_t remaining;
+	bool stopping;
+
+	void run() {
+		for (;;) {
+			std::function<void(RenderQueue &)> job;
+			RenderQueue* buffer;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || next < jobs.size(); });
+				if (stopping) break;
+				job = std::move(jobs[next]);
+				buffer = buffers[next].get();
+				++next;
+			}
+			job(*buffer);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--remaining == 0) done.notify_all();
+			}
+		}
+	}
+};
+
+#endif // !COMMAND_RECORDER_H
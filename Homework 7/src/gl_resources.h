@@ -0,0 +1,288 @@
+#ifndef GL_RESOURCES_H
+#define GL_RESOURCES_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+
+// Kinds of GL objects kept in the pools
+enum GLResourceType {
+	GL_RESOURCE_BUFFER       = 0,
+	GL_RESOURCE_VERTEX_ARRAY = 1,
+	GL_RESOURCE_TEXTURE      = 2,
+	GL_RESOURCE_FRAMEBUFFER  = 3,
+	GL_RESOURCE_PROGRAM      = 4,
+	GL_RESOURCE_RENDERBUFFER = 5,
+	GL_RESOURCE_TYPES        = 6
+};
+
+const char* const GL_RESOURCE_NAMES[GL_RESOURCE_TYPES] = { "buffers", "vertex arrays", "textures", "framebuffers", "programs", "renderbuffers" };
+
+// Reference to a pooled GL object: a slot and the generation of the object
+// in it. Destroying the object bumps the generation, so handles kept around
+// afterwards resolve to 0 instead of to whatever reuses the slot or the name.
+// The type parameter keeps e.g. a texture from being passed as a buffer.
+template <GLResourceType Type>
+struct GLHandle {
+	uint32_t Index;
+	uint32_t Generation; // 0 for the null handle
+
+	GLHandle() : Index(0), Generation(0) {}
+	GLHandle(uint32_t index, uint32_t generation) : Index(index), Generation(generation) {}
+
+	bool valid() const {
+		return Generation != 0;
+	}
+};
+
+typedef GLHandle<GL_RESOURCE_BUFFER>       BufferHandle;
+typedef GLHandle<GL_RESOURCE_VERTEX_ARRAY> VertexArrayHandle;
+typedef GLHandle<GL_RESOURCE_TEXTURE>      TextureHandle;
+typedef GLHandle<GL_RESOURCE_FRAMEBUFFER>  FramebufferHandle;
+typedef GLHandle<GL_RESOURCE_PROGRAM>      ProgramHandle;
+typedef GLHandle<GL_RESOURCE_RENDERBUFFER> RenderbufferHandle;
+
+struct GLResourceStats {
+	unsigned int Live[GL_RESOURCE_TYPES];
+	size_t Memory[GL_RESOURCE_TYPES]; // estimated bytes, as reported with setMemory()
+	unsigned int Pending;             // destroyed, waiting for the GPU
+	unsigned int Created, Destroyed;  // since the start
+
+	unsigned int liveNum() const {
+		unsigned int sum = 0;
+		for (unsigned int live : Live) sum += live;
+		return sum;
+	}
+
+	size_t memory() const {
+		size_t sum = 0;
+		for (size_t bytes : Memory) sum += bytes;
+		return sum;
+	}
+};
+
+// Owner of the GL objects of the context. Objects are created through typed
+// handles, and destroy() only retires them: the names are deleted once a
+// fence inserted at the end of the frame has passed, when no queued command
+// can use them any more. Live objects and their estimated memory are counted
+// per type, so an object created every frame shows up as a growing count.
+//
+// endFrame() must be called once per frame and release() before the context
+// goes away; objects still alive then are reported as leaks.
+class GLResources {
+public:
+	// called with every name before it is deleted, e.g. to drop it from a state cache
+	std::function<void(GLResourceType, GLuint)> OnDelete;
+
+	static GLResources &get() {
+		static GLResources resources;
+		return resources;
+	}
+
+	BufferHandle createBuffer() {
+		GLuint name;
+		glGenBuffers(1, &name);
+		return create<GL_RESOURCE_BUFFER>(name);
+	}
+
+	VertexArrayHandle createVertexArray() {
+		GLuint name;
+		glGenVertexArrays(1, &name);
+		return create<GL_RESOURCE_VERTEX_ARRAY>(name);
+	}
+
+	TextureHandle createTexture() {
+		GLuint name;
+		glGenTextures(1, &name);
+		return create<GL_RESOURCE_TEXTURE>(name);
+	}
+
+	FramebufferHandle createFramebuffer() {
+		GLuint name;
+		glGenFramebuffers(1, &name);
+		return create<GL_RESOURCE_FRAMEBUFFER>(name);
+	}
+
+	ProgramHandle createProgram() {
+		return create<GL_RESOURCE_PROGRAM>(glCreateProgram());
+	}
+
+	RenderbufferHandle createRenderbuffer() {
+		GLuint name;
+		glGenRenderbuffers(1, &name);
+		return create<GL_RESOURCE_RENDERBUFFER>(name);
+	}
+
+	// the GL name of a handle, 0 if it was destroyed
+	template <GLResourceType Type>
+	GLuint name(GLHandle<Type> handle) const {
+		const Slot* slot = find(Type, handle.Index, handle.Generation);
+		return slot == NULL ? 0 : slot->Name;
+	}
+
+	template <GLResourceType Type>
+	bool alive(GLHandle<Type> handle) const {
+		return find(Type, handle.Index, handle.Generation) != NULL;
+	}
+
+	// records the estimated GPU memory of an object after its storage is specified
+	template <GLResourceType Type>
+	void setMemory(GLHandle<Type> handle, size_t bytes) {
+		Slot* slot = find(Type, handle.Index, handle.Generation);
+		if (slot == NULL) return;
+		current.Memory[Type] = current.Memory[Type] - slot->Memory + bytes;
+		slot->Memory = bytes;
+	}
+
+	// retires an object, its name is deleted once the GPU finished the frame;
+	// the handle is reset and stale copies of it resolve to 0 from now on
+	template <GLResourceType Type>
+	void destroy(GLHandle<Type> &handle) {
+		Slot* slot = find(Type, handle.Index, handle.Generation);
+		handle = GLHandle<Type>();
+		if (slot == NULL) return;
+		retired.push_back({ Type, slot->Name, slot->Memory });
+		--current.Live[Type];
+		++current.Pending;
+		++current.Destroyed;
+		slot->Name = 0;
+		slot->Memory = 0;
+		// a generation of 0 would be the null handle
+		if (++slot->Generation == 0) slot->Generation = 1;
+		freeSlots[Type].push_back((uint32_t)(slot - slots[Type].data()));
+	}
+
+	// call once per frame after its commands are issued, e.g. before swapping buffers
+	void endFrame() {
+		if (!retired.empty()) {
+			frames.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::vector<Retired>() });
+			frames.back().Objects.swap(retired);
+		}
+		while (!frames.empty()) {
+			GLenum status = glClientWaitSync(frames.front().Fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+			retire(frames.front());
+			frames.pop_front();
+		}
+	}
+
+	// estimated size of a 2D texture, a full mipmap chain adds a third
+	static size_t textureBytes(unsigned int width, unsigned int height, unsigned int bytesPerTexel, bool mipmaps = false) {
+		size_t bytes = (size_t)width * height * bytesPerTexel;
+		return mipmaps ? bytes + bytes / 3 : bytes;
+	}
+
+	const GLResourceStats &stats() const {
+		return current;
+	}
+
+	// deletes every object, must be called while the context is alive
+	void release() {
+		if (!retired.empty()) frames.push_back({ 0, retired });
+		retired.clear();
+		for (Frame &frame : frames)
+			retire(frame);
+		frames.clear();
+		for (unsigned int type = 0; type < GL_RESOURCE_TYPES; ++type) {
+			if (current.Live[type] > 0)
+				std::cout << "ERROR::GL_RESOURCES::LEAKED: " << current.Live[type] << " " << GL_RESOURCE_NAMES[type] << std::endl;
+			for (Slot &slot : slots[type]) {
+				if (slot.Name == 0) continue;
+				deleteObject((GLResourceType)type, slot.Name);
+				slot.Name = 0;
+			}
+			slots[type].clear();
+			freeSlots[type].clear();
+			current.Live[type] = 0;
+			current.Memory[type] = 0;
+		}
+	}
+
+private:
+	struct Slot {
+		GLuint Name; // 0 when free
+		uint32_t Generation;
+		size_t Memory;
+	};
+
+	struct Retired {
+		GLResourceType Type;
+		GLuint Name;
+		size_t Memory;
+	};
+
+	// objects retired in one frame and the fence behind its commands
+	struct Frame {
+		GLsync Fence;
+		std::vector<Retired> Objects;
+	};
+
+	std::vector<Slot> slots[GL_RESOURCE_TYPES];
+	std::vector<uint32_t> freeSlots[GL_RESOURCE_TYPES];
+	std::vector<Retired> retired; // in the current frame
+	std::deque<Frame> frames;
+	GLResourceStats current;
+
+	GLResources() : current() {}
+
+	template <GLResourceType Type>
+	GLHandle<Type> create(GLuint name) {
+		uint32_t index = add(Type, name);
+		return GLHandle<Type>(index, slots[Type][index].Generation);
+	}
+
+	uint32_t add(GLResourceType type, GLuint name) {
+		uint32_t index;
+		if (freeSlots[type].empty()) {
+			index = (uint32_t)slots[type].size();
+			slots[type].push_back({ 0, 1, 0 });
+		}
+		else {
+			index = freeSlots[type].back();
+			freeSlots[type].pop_back();
+		}
+		slots[type][index].Name = name;
+		++current.Live[type];
+		++current.Created;
+		return index;
+	}
+
+	const Slot* find(GLResourceType type, uint32_t index, uint32_t generation) const {
+		if (generation == 0 || index >= slots[type].size()) return NULL;
+		const Slot &slot = slots[type][index];
+		return slot.Generation == generation && slot.Name != 0 ? &slot : NULL;
+	}
+
+	Slot* find(GLResourceType type, uint32_t index, uint32_t generation) {
+		return const_cast<Slot*>(static_cast<const GLResources*>(this)->find(type, index, generation));
+	}
+
+	void retire(Frame &frame) {
+		for (const Retired &object : frame.Objects) {
+			deleteObject(object.Type, object.Name);
+			current.Memory[object.Type] -= object.Memory;
+			--current.Pending;
+		}
+		if (frame.Fence != 0) glDeleteSync(frame.Fence);
+	}
+
+	void deleteObject(GLResourceType type, GLuint name) {
+		if (OnDelete) OnDelete(type, name);
+		switch (type) {
+		case GL_RESOURCE_BUFFER:       glDeleteBuffers(1, &name); break;
+		case GL_RESOURCE_VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+		case GL_RESOURCE_TEXTURE:      glDeleteTextures(1, &name); break;
+		case GL_RESOURCE_FRAMEBUFFER:  glDeleteFramebuffers(1, &name); break;
+		case GL_RESOURCE_PROGRAM:      glDeleteProgram(name); break;
+		case GL_RESOURCE_RENDERBUFFER: glDeleteRenderbuffers(1, &name); break;
+		default: break;
+		}
+	}
+};
+
+#endif // !GL_RESOURCES_H
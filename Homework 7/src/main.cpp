@@ -12,18 +12,34 @@
 
 #include "shader.h"
 #include "camera.h"
+#include "mesh.h"
+#include "obj_loader.h"
+#include "mesh_cache.h"
+#include "uniform_block.h"
+#include "shader_compiler.h"
+#include "shader_variants.h"
+#include "shader_watcher.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "command_recorder.h"
+#include "profiler.h"
+#include "headless.h"
+#include "frame_capture.h"
+#include "gl_resources.h"
 
 #include <iostream>
+#include <filesystem>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 
-unsigned int loadTexture(const char *path);
+TextureHandle loadTexture(const char *path);
+Mesh loadModel(const std::string &path);
 
-void renderScene(const Shader &shader);
-void renderCube();
+void submitScene(RenderQueue &queue, RenderPass pass, const Shader &shader, unsigned int texture, const glm::vec3 &eye);
+const Mesh &getCube();
 
 // default setting
 const unsigned int WIDTH = 800;
@@ -42,15 +58,17 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// VAO for pa
-unsigned int planeVAO;
+// indexed meshes of the scene
+Mesh plane, cube, objModel;
 
-int main() {
+int main(int argc, char* argv[]) {
 	//----------------------------------------------------------------
 	// Initialize and configure GLFW
 	// Version: 3.3
 	// Profile: CORE
-	glfwInit();
+	// --headless renders offscreen without a display, see headless.h
+	Headless headless(argc, argv, WIDTH, HEIGHT);
+	headless.init();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -58,7 +76,7 @@ int main() {
 	// Create GLFW window
 	// Width:  800
 	// Height: 600
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "HW7", NULL, NULL);
+	GLFWwindow* window = headless.createWindow(WIDTH, HEIGHT, "HW7");
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window." << std::endl;
 		glfwTerminate();
@@ -75,6 +93,19 @@ int main() {
 		return -1;
 	}
 
+	// every GL object lives in pools that count it, deleted ones are dropped
+	// from the state cache
+	GLResources &resources = GLResources::get();
+	resources.OnDelete = [](GLResourceType type, GLuint name) { GLState::get().forget(type, name); };
+
+	// offscreen framebuffer of the headless mode
+	if (!headless.setup()) {
+		glfwTerminate();
+		return -1;
+	}
+	// --capture DIR writes every frame to DIR, see frame_capture.h
+	FrameCapture capture(headless.Arguments, headless.width(), headless.height());
+
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// Setup ImGui Context
@@ -93,10 +124,40 @@ int main() {
 	// configure global opengl states
 	glEnable(GL_DEPTH_TEST);
 
-	// build and compile shaders
+	// build and compile shaders, they compile while the scene is loaded and
+	// the first frames are shown
 	// -------------------------
-	Shader shader("shadow_mapping.vs", "shadow_mapping.fs");
-	Shader depthShader("shadow_mapping_depth.vs", "shadow_mapping_depth.fs");
+	ShaderCompiler compiler(window);
+	// saving a shader file rebuilds the programs using it while the app keeps running
+	ShaderWatcher watcher(compiler);
+	ShaderVariants shadowVariants("shadow_mapping.vs", "shadow_mapping.fs", &compiler, &watcher);
+	Shader depthShader("shadow_mapping_depth.vs", "shadow_mapping_depth.fs", true);
+	compiler.submit(depthShader);
+	bool shadersReady = false;
+	float firstFrameTime = -1.0f;
+
+	// per-frame camera and light data, shared by both programs
+	UniformBlock<CameraBlock> cameraBlock(CAMERA_BINDING);
+	UniformBlock<LightBlock> lightBlock(LIGHT_BINDING);
+
+	// shader configuration, done for every variant of the scene shader once it is built
+	// --------------------
+	shadowVariants.Configure = [&](Shader &shader) {
+		cameraBlock.bind(shader, "Camera");
+		lightBlock.bind(shader, "Light");
+		shader.use();
+		shader.setInt("woodTexture", 0);
+		shader.setInt("shadowMap", 1);
+	};
+
+	// shadow options, each combination is its own program variant
+	bool shadows = true;
+	int pcfSize = 3;
+	auto shadowDefines = [&]() {
+		return ShaderDefines{ { "SHADOWS", shadows ? "1" : "0" }, { "PCF_SIZE", std::to_string(pcfSize) } };
+	};
+	// the variant currently drawn with, kept until the one for new options is ready
+	Shader* shader = shadowVariants.get(shadowDefines());
 
 	// set up vertex data (and buffer(s)) and configure vertex attributes
 	// ------------------------------------------------------------------
@@ -113,39 +174,31 @@ int main() {
 
 	// configure plane
 	// ---------------
-	unsigned int planeVBO;
-	glGenVertexArrays(1, &planeVAO);
-	glGenBuffers(1, &planeVBO);
-
-	glBindVertexArray(planeVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
-	// positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	// normals
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	// texcoords
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glBindVertexArray(0);
+	plane = Mesh(planeVertices, sizeof(planeVertices) / sizeof(float), { 3, 3, 2 });
+	plane.printStats("plane");
+	// the cube too, recording threads must not create GL objects
+	getCube();
+
+	// optional model given on the command line, e.g. `HW7 bunny.obj`
+	// ----------------------------------------------------------------
+	if (!headless.Arguments.empty()) {
+		objModel = loadModel(headless.Arguments[0]);
+	}
 
 	// load textures
 	// -------------
-	unsigned int woodTexture = loadTexture("assets/wood.png");
+	TextureHandle woodTexture = loadTexture("assets/wood.png");
 
 	// configure depth map FBO
 	// -----------------------
 	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-	unsigned int depthMapFBO;
-	glGenFramebuffers(1, &depthMapFBO);
+	FramebufferHandle depthMapFBO = resources.createFramebuffer();
 
 	// create depth texture
-	unsigned int depthMap;
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
+	TextureHandle depthMap = resources.createTexture();
+	GLState::get().bindTexture(0, GL_TEXTURE_2D, resources.name(depthMap));
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	resources.setMemory(depthMap, GLResources::textureBytes(SHADOW_WIDTH, SHADOW_HEIGHT, 4));
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
@@ -156,58 +209,136 @@ int main() {
 	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
 	// attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
+	GLState::get().bindFramebuffer(resources.name(depthMapFBO));
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, resources.name(depthMap), 0);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::get().bindFramebuffer(headless.framebuffer());
 
 
-	// shader configuration
-	// --------------------
-	shader.use();
-	shader.setInt("woodTexture", 0);
-	shader.setInt("shadowMap", 1);
-
 	// lighting info
 	// -------------
 	glm::vec3 lightPos(-1.0f, 6.0f, -1.0f);
 
 	int lightType = 1;
 
+	// binds go through the state cache, repeated ones are skipped
+	GLState &state = GLState::get();
+	// draws of both passes, sorted by state before they are issued
+	RenderQueue queue;
+	// the passes are recorded on worker threads while the UI is built
+	CommandRecorder recorder;
+	// "Capture trace" in the profiler window writes the timelines of all threads to trace_N.json
+	Tracer::get().nameThread("render");
+
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(window)) {
+		headless.beginFrame();
 		// per-frame time logic
 		// --------------------
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		// finish background compiles and reloads, present empty frames until
+		// every program is ready
+		{
+			PROFILE_SCOPE("shader updates");
+			compiler.poll();
+			watcher.update();
+			if (Shader* wanted = shadowVariants.get(shadowDefines())) shader = wanted;
+		}
+		if (!shadersReady) {
+			if (shader == NULL || !depthShader.Ready) {
+				glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glfwSwapBuffers(window);
+				glfwPollEvents();
+				if (firstFrameTime < 0.0f) firstFrameTime = glfwGetTime();
+				continue;
+			}
+			shadersReady = true;
+			cameraBlock.bind(depthShader, "Camera");
+			lightBlock.bind(depthShader, "Light");
+			watcher.watch(depthShader, [&](Shader &program) {
+				cameraBlock.bind(program, "Camera");
+				lightBlock.bind(program, "Light");
+			});
+			// the first run compiles and fills the binary cache, later runs load from it
+			depthShader.printStats("shadow_mapping_depth");
+			// without a frame shown yet, this frame is the first one
+			if (firstFrameTime < 0.0f) firstFrameTime = glfwGetTime();
+			std::cout << "SHADER::ready after " << glfwGetTime() * 1000.0 << " ms, first frame after "
+				<< firstFrameTime * 1000.0f << " ms (" << (compiler.Parallel ? "parallel compile" : "compile thread") << ")" << std::endl;
+		}
+
 		// input
 		// -----
-		processInput(window);
+		{
+			PROFILE_SCOPE("input");
+			processInput(window);
+		}
+
+		// record the scene once per pass, the light is the viewer of the shadow
+		// pass; without shadows the depth map is never read, so it is not drawn.
+		// Fixed for the frame, the checkbox may change while it is recorded
+		bool shadowPass = shadows;
+		if (shadowPass) {
+			recorder.record([&](RenderQueue &commands) {
+				PROFILE_SCOPE("record shadow pass");
+				submitScene(commands, RENDER_PASS_SHADOW, depthShader, 0, lightPos);
+			});
+		}
+		// resolved here, the pools are not touched from the recording threads
+		unsigned int woodTextureName = resources.name(woodTexture);
+		recorder.record([&, shader, woodTextureName](RenderQueue &commands) {
+			PROFILE_SCOPE("record main pass");
+			submitScene(commands, RENDER_PASS_OPAQUE, *shader, woodTextureName, camera.Position);
+		});
 
 		// ImGui
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
-
-		// render
-		// ------
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		ImGui::Begin("Shading options");
-		ImGui::Text("+-------------------------------+");
-		ImGui::Text("| Tips:                         |");
-		ImGui::Text("| 'ESC': exit  FPS mode.        |");
-		ImGui::Text("| 'I'  : enter FPS mode.        |");
-		ImGui::Text("+-------------------------------+");
-
-		ImGui::RadioButton("Perspective", &lightType, 0);
-		ImGui::RadioButton("Orthographic", &lightType, 1);
-		ImGui::End();
+		{
+			PROFILE_SCOPE("ImGui build");
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
+
+			ImGui::Begin("Shading options");
+			ImGui::Text("+-------------------------------+");
+			ImGui::Text("| Tips:                         |");
+			ImGui::Text("| 'ESC': exit  FPS mode.        |");
+			ImGui::Text("| 'I'  : enter FPS mode.        |");
+			ImGui::Text("+-------------------------------+");
+
+			ImGui::RadioButton("Perspective", &lightType, 0);
+			ImGui::RadioButton("Orthographic", &lightType, 1);
+
+			ImGui::Checkbox("Shadows", &shadows);
+			ImGui::Text("PCF kernel:");
+			for (int size = 1; size <= 7; size += 2) {
+				ImGui::SameLine();
+				ImGui::RadioButton((std::to_string(size) + "x" + std::to_string(size)).c_str(), &pcfSize, size);
+			}
+			ImGui::Text("Shader variants: %u", shadowVariants.variantNum());
+			ImGui::Text("Shader reloads: %u (%u failed), last %.1f ms", watcher.Reloads, watcher.Failures, watcher.LastLatency);
+
+			// uniform calls of the previous frame
+			UniformStats uniformStats = Shader::stats();
+			Shader::resetStats();
+			ImGui::Text("Uniform calls: %u issued, %u skipped", uniformStats.Issued, uniformStats.Skipped);
+
+			// binds and state changes of the previous frame
+			GLStateStats stateStats = state.Stats;
+			state.resetStats();
+			ImGui::Text("State changes: %u issued, %u elided", stateStats.Issued, stateStats.Elided);
+			ImGui::Text("Draw packets: %u (%u recording threads)", queue.packetNum(), recorder.threadNum());
+			const GLResourceStats &resourceStats = resources.stats();
+			ImGui::Text("GL objects: %u live, %u pending delete, %.1f MB", resourceStats.liveNum(), resourceStats.Pending,
+				resourceStats.memory() / (1024.0 * 1024.0));
+			ImGui::End();
+			PROFILE_OVERLAY();
+		}
 
 		// 1. render depth of scene to texture (from light's perspective)
 		// --------------------------------------------------------------
@@ -224,55 +355,97 @@ int main() {
 
 		lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
 		lightSpaceMatrix = lightProj * lightView;
-		// render scene from light's point of view
-		depthShader.use();
-		depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-		glClear(GL_DEPTH_BUFFER_BIT);
-		renderScene(depthShader);
 
-		// re-bind to default framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		// upload the per-frame blocks once for both passes
+		glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom), (float)headless.width() / (float)headless.height(), 0.1f, 100.0f);
+		glm::mat4 view = camera.getViewMatrix();
+		cameraBlock.Data.Proj = proj;
+		cameraBlock.Data.View = view;
+		cameraBlock.Data.ViewPos = glm::vec4(camera.Position, 1.0f);
+		cameraBlock.upload();
+		lightBlock.Data.LightSpaceMatrix = lightSpaceMatrix;
+		lightBlock.Data.LightPos = glm::vec4(lightPos, 1.0f);
+		lightBlock.Data.LightColor = glm::vec4(glm::vec3(0.3f), 1.0f);
+		lightBlock.upload();
+
+		// merge the recorded passes
+		{
+			PROFILE_SCOPE("gather and sort");
+			queue.clear();
+			recorder.gather(queue);
+			queue.sort();
+		}
 
-		// reset viewport
-		glViewport(0, 0, WIDTH, HEIGHT);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// render scene from light's point of view
+		if (shadowPass) {
+			PROFILE_GPU_SCOPE("shadow pass");
+			state.viewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+			state.bindFramebuffer(resources.name(depthMapFBO));
+			glClear(GL_DEPTH_BUFFER_BIT);
+			queue.execute(RENDER_PASS_SHADOW);
+		}
 
 		// 2. render scene as normal using the generated depth/shadow map  
 		// --------------------------------------------------------------
-		glViewport(0, 0, WIDTH, HEIGHT);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		shader.use();
-		glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
-		glm::mat4 view = camera.getViewMatrix();
-		shader.setMat4("proj", proj);
-		shader.setMat4("view", view);
-		// set light uniforms
-		shader.setVec3("viewPos", camera.Position);
-		shader.setVec3("lightPos", lightPos);
-		shader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, woodTexture);
-		// the depthMap has the nearest depth information of this scene
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, depthMap);
-		renderScene(shader);
-
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		{
+			PROFILE_GPU_SCOPE("main pass");
+			// re-bind to default framebuffer and reset viewport, cleared once
+			state.bindFramebuffer(headless.framebuffer());
+			state.viewport(0, 0, headless.width(), headless.height());
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			// the depthMap has the nearest depth information of this scene
+			state.bindTexture(1, GL_TEXTURE_2D, resources.name(depthMap));
+			queue.execute(RENDER_PASS_OPAQUE);
+		}
+
+		// read the frame back before the UI is drawn over it
+		{
+			PROFILE_SCOPE("capture");
+			capture.capture();
+		}
+
+		{
+			PROFILE_GPU_SCOPE("ImGui render");
+			ImGui::Render();
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			// the ImGui renderer binds its own objects behind the cache's back
+			state.invalidate();
+		}
+
+		resources.endFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		{
+			PROFILE_SCOPE("swap");
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+		PROFILE_FRAME();
+		headless.endFrame(window);
 	}
 
 	// optional: de-allocate all resources once they've outlived their purpose:
 	// ------------------------------------------------------------------------
-	glDeleteVertexArrays(1, &planeVAO);
-	glDeleteBuffers(1, &planeVBO);
+	resources.destroy(woodTexture);
+	resources.destroy(depthMap);
+	resources.destroy(depthMapFBO);
+	plane.release();
+	cube.release();
+	objModel.release();
+	cameraBlock.release();
+	lightBlock.release();
+	compiler.release();
+	watcher.release();
+	shadowVariants.release();
+	depthShader.release();
+	recorder.release();
+	Profiler::get().release();
+	capture.release();
+	headless.release();
+	// anything still alive now is reported as a leak
+	resources.release();
 
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
@@ -282,44 +455,49 @@ int main() {
 	return 0;
 }
 
-// renders the 3D scene
+// submits the draws of the 3D scene for one pass, `eye` is the viewer of
+// the pass and orders the draws by distance
 // --------------------
-void renderScene(const Shader &shader) {
+void submitScene(RenderQueue &queue, RenderPass pass, const Shader &shader, unsigned int texture, const glm::vec3 &eye) {
+	auto submit = [&](const Mesh &mesh, const glm::mat4 &model) {
+		queue.submit(pass, shader, mesh, texture, model, glm::length(eye - glm::vec3(model[3])));
+	};
+
 	// floor
 	glm::mat4 model = glm::mat4(1.0f);
-	shader.setMat4("model", model);
-	glBindVertexArray(planeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	submit(plane, model);
 
 	// The positions of cubes are just copied from LearningOpenGL
 	// -----------------------------------------------------
 	// cubes
+	const Mesh &cube = getCube();
 	model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0));
 	model = glm::scale(model, glm::vec3(0.5f));
-	shader.setMat4("model", model);
-	renderCube();
+	submit(cube, model);
 	model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
 	model = glm::scale(model, glm::vec3(0.5f));
-	shader.setMat4("model", model);
-	renderCube();
+	submit(cube, model);
 	model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
 	model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
 	model = glm::scale(model, glm::vec3(0.25));
-	shader.setMat4("model", model);
-	renderCube();
+	submit(cube, model);
+
+	// loaded model, drawn in its own model space
+	if (objModel.VAO != 0) {
+		model = glm::mat4(1.0f);
+		submit(objModel, model);
+	}
 }
 
 
-// renderCube() renders a 1x1 3D cube in NDC.
+// getCube() returns a 1x1 3D cube in NDC.
 // -------------------------------------------------
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
-void renderCube() {
+const Mesh &getCube() {
 	// initialize (if necessary)
-	if (cubeVAO == 0) {
+	if (cube.VAO == 0) {
 		float vertices[] = {
 			// back face
 			-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
@@ -364,32 +542,14 @@ void renderCube() {
 			-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
 			-1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
 		};
-		glGenVertexArrays(1, &cubeVAO);
-		glGenBuffers(1, &cubeVBO);
-		// fill buffer
-		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-		// link vertex attributes
-		glBindVertexArray(cubeVAO);
-		// positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		// normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		// texcoords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glBindVertexArray(0);
+		cube = Mesh(vertices, sizeof(vertices) / sizeof(float), { 3, 3, 2 });
+		cube.printStats("cube");
 	}
-	// render Cube
-	glBindVertexArray(cubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	return cube;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
 }
 
 // keyboard input event callback
@@ -440,13 +600,53 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 	camera.processMouseScroll(yoffset);
 }
 
+// utility function for loading a model from an OBJ file or a mesh cache.
+// `<name>.obj` is converted to `<name>.obj.mesh` on first use, later runs map
+// the cache and upload it without parsing.
+// ---------------------------------------------------------------------------
+Mesh loadModel(const std::string &path) {
+	const std::vector<int> layout = { 3, 3, 2 };
+	bool isCache = path.size() > 5 && path.compare(path.size() - 5, 5, ".mesh") == 0;
+	std::string cachePath = isCache ? path : path + ".mesh";
+
+	// a cache older than its OBJ file is stale and gets rebuilt
+	std::error_code error;
+	bool stale = !isCache && std::filesystem::exists(cachePath, error) &&
+		std::filesystem::last_write_time(path, error) > std::filesystem::last_write_time(cachePath, error);
+	if (!stale) {
+		MeshCache cache(cachePath.c_str());
+		if (cache.Loaded && cache.Layout == layout) {
+			cache.printStats(cachePath);
+			Mesh mesh(cache.Vertices, cache.Header->VertexCount, cache.Indices, cache.Header->IndexCount, layout);
+			mesh.printStats(cachePath);
+			return mesh;
+		}
+		if (isCache) {
+			std::cout << "Mesh cache failed to load at path: " << path << std::endl;
+			return Mesh();
+		}
+	}
+
+	ObjLoader loader(path.c_str());
+	if (!loader.Loaded) return Mesh();
+	loader.printStats(path);
+	// optimize before caching so later runs get the optimized order for free
+	unsigned int vertexCount = (unsigned int)(loader.Vertices.size() / 8);
+	Mesh::optimizeVertexCache(loader.Indices, vertexCount);
+	saveMeshCache(cachePath.c_str(), loader.Vertices.data(), vertexCount, loader.Indices.data(), (uint32_t)loader.Indices.size(), layout);
+
+	Mesh mesh(std::move(loader.Vertices), std::move(loader.Indices), layout, false);
+	mesh.printStats(path);
+	return mesh;
+}
+
 // This function is from @LearningOpenGL
 // utility function for loading a 2D texture from file
 // ---------------------------------------------------
-unsigned int loadTexture(char const * path)
+TextureHandle loadTexture(char const * path)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	TextureHandle texture = GLResources::get().createTexture();
+	unsigned int textureID = GLResources::get().name(texture);
 
 	int width, height, nrComponents;
 	unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
@@ -459,9 +659,10 @@ unsigned int loadTexture(char const * path)
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::get().bindTexture(0, GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
+		GLResources::get().setMemory(texture, GLResources::textureBytes(width, height, nrComponents, true));
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
@@ -475,5 +676,5 @@ unsigned int loadTexture(char const * path)
 		stbi_image_free(data);
 	}
 
-	return textureID;
+	return texture;
 }
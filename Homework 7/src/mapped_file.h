@@ -0,0 +1,75 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+	const char* Data;
+	size_t Size;
+
+	MappedFile(const char* path) : Data(NULL), Size(0) {
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		mapping = NULL;
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) return;
+		Data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (Data != NULL) Size = (size_t)size.QuadPart;
+#else
+		fd = open(path, O_RDONLY);
+		if (fd < 0) return;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) return;
+		void* addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED) return;
+		// the file is read front to back by every worker
+		madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+		Data = (const char*)addr;
+		Size = (size_t)st.st_size;
+#endif
+	}
+
+	~MappedFile() {
+#ifdef _WIN32
+		if (Data != NULL) UnmapViewOfFile(Data);
+		if (mapping != NULL) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (Data != NULL) munmap((void*)Data, Size);
+		if (fd >= 0) close(fd);
+#endif
+	}
+
+	bool valid() const {
+		return Data != NULL;
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+#endif // !MAPPED_FILE_H
@@ -0,0 +1,189 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+
+#include "mapped_file.h"
+
+// Binary mesh cache layout (little endian):
+//
+//     MeshCacheHeader                               80 bytes
+//     padding up to MESH_CACHE_ALIGNMENT
+//     vertex section: VertexCount * Stride floats   aligned to MESH_CACHE_ALIGNMENT
+//     padding up to MESH_CACHE_ALIGNMENT
+//     index section: IndexCount unsigned ints       aligned to MESH_CACHE_ALIGNMENT
+//
+// Both sections are page aligned so a mapping of the file can be handed to
+// glBufferData as is.
+const char MESH_CACHE_MAGIC[8] = { 'C', 'G', 'M', 'E', 'S', 'H', '\r', '\n' };
+const uint32_t MESH_CACHE_VERSION = 1;
+const uint64_t MESH_CACHE_ALIGNMENT = 4096;
+const unsigned int MESH_CACHE_MAX_ATTRIBUTES = 4;
+
+struct MeshCacheHeader {
+	char Magic[8];
+	uint32_t Version;
+	uint32_t HeaderSize;
+	// number of floats of each attribute, 0 for unused slots
+	uint8_t Layout[MESH_CACHE_MAX_ATTRIBUTES];
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	// axis aligned bounding box of the positions (first attribute)
+	float BoundsMin[3];
+	float BoundsMax[3];
+	uint64_t VertexOffset;
+	uint64_t IndexOffset;
+	// hash of the vertex and the index section
+	uint64_t Checksum;
+};
+static_assert(sizeof(MeshCacheHeader) == 80, "MeshCacheHeader layout changed, bump MESH_CACHE_VERSION");
+
+// 64-bit hash of a buffer, processing 8 bytes per step so verifying a cache
+// is bound by memory bandwidth rather than by the hash itself
+inline uint64_t meshCacheHash(const void* data, size_t size, uint64_t seed = 0x9E3779B97F4A7C15ull) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t h = seed ^ (size * 0xC2B2AE3D27D4EB4Full);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, 8);
+		word *= 0x87C37B91114253D5ull;
+		word = (word << 31) | (word >> 33);
+		h ^= word * 0x4CF5AD432745937Full;
+		h = ((h << 27) | (h >> 37)) * 5 + 0x52DCE729;
+	}
+	for (; i < size; ++i) h = (h ^ bytes[i]) * 0x100000001B3ull;
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	return h;
+}
+
+// Writes indexed, interleaved mesh data as a mesh cache. Returns false on failure.
+inline bool saveMeshCache(const char* path, const float* vertices, uint32_t vertexCount,
+	const unsigned int* indices, uint32_t indexCount, const std::vector<int> &layout) {
+	if (layout.empty() || layout.size() > MESH_CACHE_MAX_ATTRIBUTES || layout[0] < 3) {
+		std::cout << "ERROR::MESH_CACHE::UNSUPPORTED_LAYOUT" << std::endl;
+		return false;
+	}
+	unsigned int stride = 0;
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.Magic, MESH_CACHE_MAGIC, sizeof(header.Magic));
+	header.Version = MESH_CACHE_VERSION;
+	header.HeaderSize = sizeof(MeshCacheHeader);
+	for (size_t i = 0; i < layout.size(); ++i) {
+		header.Layout[i] = (uint8_t)layout[i];
+		stride += layout[i];
+	}
+	header.VertexCount = vertexCount;
+	header.IndexCount = indexCount;
+
+	for (int k = 0; k < 3; ++k) {
+		header.BoundsMin[k] = vertexCount ? vertices[k] : 0.0f;
+		header.BoundsMax[k] = vertexCount ? vertices[k] : 0.0f;
+	}
+	for (uint32_t v = 0; v < vertexCount; ++v) {
+		const float* position = vertices + (size_t)v * stride;
+		for (int k = 0; k < 3; ++k) {
+			if (position[k] < header.BoundsMin[k]) header.BoundsMin[k] = position[k];
+			if (position[k] > header.BoundsMax[k]) header.BoundsMax[k] = position[k];
+		}
+	}
+
+	uint64_t vertexBytes = (uint64_t)vertexCount * stride * sizeof(float);
+	uint64_t indexBytes = (uint64_t)indexCount * sizeof(unsigned int);
+	header.VertexOffset = MESH_CACHE_ALIGNMENT;
+	header.IndexOffset = (header.VertexOffset + vertexBytes + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+	header.Checksum = meshCacheHash(indices, indexBytes, meshCacheHash(vertices, vertexBytes));
+
+	FILE* file = std::fopen(path, "wb");
+	if (file == NULL) {
+		std::cout << "ERROR::MESH_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	static const char zeros[MESH_CACHE_ALIGNMENT] = { 0 };
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && std::fwrite(zeros, 1, header.VertexOffset - sizeof(header), file) == header.VertexOffset - sizeof(header);
+	ok = ok && std::fwrite(vertices, 1, vertexBytes, file) == vertexBytes;
+	uint64_t padding = header.IndexOffset - header.VertexOffset - vertexBytes;
+	ok = ok && std::fwrite(zeros, 1, padding, file) == padding;
+	ok = ok && std::fwrite(indices, 1, indexBytes, file) == indexBytes;
+	ok = (std::fclose(file) == 0) && ok;
+	if (!ok) {
+		std::cout << "ERROR::MESH_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+		std::remove(path);
+	}
+	return ok;
+}
+
+// Read-only view of a mesh cache. The vertex and index sections point into the
+// file mapping and stay valid as long as the MeshCache object lives.
+class MeshCache {
+public:
+	const MeshCacheHeader* Header;
+	const float* Vertices;
+	const unsigned int* Indices;
+	std::vector<int> Layout;
+	bool Loaded;
+	double LoadTime; // milliseconds
+
+	MeshCache(const char* path, bool verify = true) : Header(NULL), Vertices(NULL), Indices(NULL), Loaded(false), LoadTime(0.0), file(path) {
+		auto start = std::chrono::steady_clock::now();
+		if (!file.valid()) return;
+		if (file.Size < sizeof(MeshCacheHeader)) {
+			std::cout << "ERROR::MESH_CACHE::TRUNCATED: " << path << std::endl;
+			return;
+		}
+		const MeshCacheHeader* header = (const MeshCacheHeader*)file.Data;
+		if (std::memcmp(header->Magic, MESH_CACHE_MAGIC, sizeof(header->Magic)) != 0 ||
+			header->Version != MESH_CACHE_VERSION || header->HeaderSize != sizeof(MeshCacheHeader)) {
+			std::cout << "ERROR::MESH_CACHE::VERSION_MISMATCH: " << path << std::endl;
+			return;
+		}
+
+		unsigned int stride = 0;
+		for (unsigned int i = 0; i < MESH_CACHE_MAX_ATTRIBUTES && header->Layout[i] != 0; ++i) {
+			Layout.push_back(header->Layout[i]);
+			stride += header->Layout[i];
+		}
+		uint64_t vertexBytes = (uint64_t)header->VertexCount * stride * sizeof(float);
+		uint64_t indexBytes = (uint64_t)header->IndexCount * sizeof(unsigned int);
+		if (header->VertexOffset % MESH_CACHE_ALIGNMENT != 0 || header->IndexOffset % MESH_CACHE_ALIGNMENT != 0 ||
+			header->VertexOffset + vertexBytes > header->IndexOffset || header->IndexOffset + indexBytes > file.Size) {
+			std::cout << "ERROR::MESH_CACHE::TRUNCATED: " << path << std::endl;
+			return;
+		}
+
+		const float* vertices = (const float*)(file.Data + header->VertexOffset);
+		const unsigned int* indices = (const unsigned int*)(file.Data + header->IndexOffset);
+		if (verify && meshCacheHash(indices, indexBytes, meshCacheHash(vertices, vertexBytes)) != header->Checksum) {
+			std::cout << "ERROR::MESH_CACHE::CHECKSUM_MISMATCH: " << path << std::endl;
+			return;
+		}
+
+		Header = header;
+		Vertices = vertices;
+		Indices = indices;
+		LoadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Loaded = true;
+	}
+
+	// prints size and timing of the load
+	void printStats(const std::string &name) const {
+		std::cout << "MESH_CACHE::" << name << ": " << Header->IndexCount / 3 << " triangles, "
+			<< Header->VertexCount << " vertices, " << file.Size / (1024.0 * 1024.0) << " MB mapped in "
+			<< LoadTime << " ms" << std::endl;
+	}
+
+private:
+	MappedFile file;
+};
+
+#endif // !MESH_CACHE_H
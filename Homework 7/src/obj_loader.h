@@ -0,0 +1,370 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+
+#include "mapped_file.h"
+
+// Default loader options
+const size_t OBJ_MIN_CHUNK_SIZE = 1 << 20; // don't split files into chunks smaller than 1 MB
+const unsigned int OBJ_NO_INDEX = 0xFFFFFFFFu;
+
+// Wavefront OBJ loader producing an indexed, interleaved vertex buffer with
+// the position/normal/texcoord layout used by shadow_mapping.vs.
+//
+// The file is memory-mapped and split into line-aligned chunks parsed by one
+// thread each. A first pass counts the v/vt/vn records of every chunk so the
+// second pass can write attributes straight into their final place and resolve
+// relative (negative) indices. No allocation is done per line.
+class ObjLoader {
+public:
+	// interleaved position (3), normal (3), texcoord (2)
+	std::vector<float> Vertices;
+	std::vector<unsigned int> Indices;
+	bool Loaded;
+	// statistics of the last load
+	unsigned int ThreadNum;
+	size_t FileSize;
+	double LoadTime; // milliseconds
+
+	ObjLoader(const char* path, unsigned int threadNum = 0) : Loaded(false), ThreadNum(0), FileSize(0), LoadTime(0.0) {
+		auto start = std::chrono::steady_clock::now();
+		MappedFile file(path);
+		if (!file.valid()) {
+			std::cout << "ERROR::OBJ::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+			return;
+		}
+		FileSize = file.Size;
+
+		if (threadNum == 0) threadNum = std::thread::hardware_concurrency();
+		if (threadNum == 0) threadNum = 1;
+		size_t maxChunks = file.Size / OBJ_MIN_CHUNK_SIZE + 1;
+		if (threadNum > maxChunks) threadNum = (unsigned int)maxChunks;
+		ThreadNum = threadNum;
+
+		std::vector<Chunk> chunks(threadNum);
+		splitChunks(file.Data, file.Size, chunks);
+
+		// 1. count records so every chunk knows where its attributes go
+		parallelFor(chunks, [](Chunk &chunk) { chunk.count(); });
+		size_t positionNum = 0, texcoordNum = 0, normalNum = 0;
+		for (Chunk &chunk : chunks) {
+			chunk.PositionBase = positionNum;
+			chunk.TexcoordBase = texcoordNum;
+			chunk.NormalBase = normalNum;
+			positionNum += chunk.PositionNum;
+			texcoordNum += chunk.TexcoordNum;
+			normalNum += chunk.NormalNum;
+		}
+		if (positionNum == 0) {
+			std::cout << "ERROR::OBJ::NO_VERTICES: " << path << std::endl;
+			return;
+		}
+		positions.resize(positionNum * 3);
+		texcoords.resize(texcoordNum * 2);
+		normals.resize(normalNum * 3);
+
+		// 2. parse attributes in place and triangulate faces
+		parallelFor(chunks, [this](Chunk &chunk) {
+			chunk.parse(positions.data(), texcoords.data(), normals.data());
+		});
+
+		// 3. merge (position, texcoord, normal) triplets into unique vertices
+		if (!buildVertices(chunks)) return;
+
+		LoadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Loaded = true;
+	}
+
+	// prints size and timing of the load
+	void printStats(const std::string &name) const {
+		std::cout << "OBJ::" << name << ": " << Indices.size() / 3 << " triangles, "
+			<< Vertices.size() / 8 << " vertices, " << FileSize / (1024.0 * 1024.0) << " MB parsed in "
+			<< LoadTime << " ms with " << ThreadNum << " threads" << std::endl;
+	}
+
+private:
+	// a corner of a triangle, indices are 0-based and absolute
+	struct Corner {
+		unsigned int Position, Texcoord, Normal;
+	};
+
+	struct Chunk {
+		const char* Begin;
+		const char* End;
+		size_t PositionNum, TexcoordNum, NormalNum;
+		size_t PositionBase, TexcoordBase, NormalBase;
+		std::vector<Corner> Corners; // three per triangle
+		bool Error;
+
+		Chunk() : Begin(NULL), End(NULL), PositionNum(0), TexcoordNum(0), NormalNum(0),
+			PositionBase(0), TexcoordBase(0), NormalBase(0), Error(false) {}
+
+		void count() {
+			for (const char* p = Begin; p < End; p = nextLine(p, End)) {
+				p = skipSpaces(p, End);
+				if (p + 1 >= End || p[0] != 'v') continue;
+				if (isSpace(p[1])) ++PositionNum;
+				else if (p[1] == 't' && p + 2 < End && isSpace(p[2])) ++TexcoordNum;
+				else if (p[1] == 'n' && p + 2 < End && isSpace(p[2])) ++NormalNum;
+			}
+		}
+
+		void parse(float* positions, float* texcoords, float* normals) {
+			float* position = positions + PositionBase * 3;
+			float* texcoord = texcoords + TexcoordBase * 2;
+			float* normal = normals + NormalBase * 3;
+			size_t positionIndex = PositionBase, texcoordIndex = TexcoordBase, normalIndex = NormalBase;
+			// rough guess: a face line takes about 30 bytes
+			Corners.reserve((End - Begin) / 30 * 3);
+
+			Corner polygon[3];
+			for (const char* p = Begin; p < End; p = nextLine(p, End)) {
+				p = skipSpaces(p, End);
+				if (p + 1 >= End) continue;
+				if (p[0] == 'v') {
+					if (isSpace(p[1])) {
+						p = parseFloat(p + 1, End, position[0]);
+						p = parseFloat(p, End, position[1]);
+						p = parseFloat(p, End, position[2]);
+						position += 3;
+						++positionIndex;
+					}
+					else if (p[1] == 't' && p + 2 < End && isSpace(p[2])) {
+						p = parseFloat(p + 2, End, texcoord[0]);
+						p = parseFloat(p, End, texcoord[1]);
+						texcoord += 2;
+						++texcoordIndex;
+					}
+					else if (p[1] == 'n' && p + 2 < End && isSpace(p[2])) {
+						p = parseFloat(p + 2, End, normal[0]);
+						p = parseFloat(p, End, normal[1]);
+						p = parseFloat(p, End, normal[2]);
+						normal += 3;
+						++normalIndex;
+					}
+				}
+				else if (p[0] == 'f' && isSpace(p[1])) {
+					// triangulate polygons as a fan around the first corner
+					int cornerNum = 0;
+					p = skipSpaces(p + 1, End);
+					while (p < End && *p != '\n' && *p != '\r' && *p != '#') {
+						Corner corner;
+						p = parseCorner(p, End, positionIndex, texcoordIndex, normalIndex, corner);
+						if (corner.Position == OBJ_NO_INDEX) {
+							Error = true;
+							break;
+						}
+						if (cornerNum < 2) {
+							polygon[cornerNum] = corner;
+						}
+						else {
+							polygon[2] = corner;
+							Corners.insert(Corners.end(), polygon, polygon + 3);
+							polygon[1] = corner;
+						}
+						++cornerNum;
+						p = skipSpaces(p, End);
+					}
+				}
+			}
+		}
+	};
+
+	std::vector<float> positions, texcoords, normals;
+
+	static bool isSpace(char c) {
+		return c == ' ' || c == '\t';
+	}
+
+	static const char* skipSpaces(const char* p, const char* end) {
+		while (p < end && isSpace(*p)) ++p;
+		return p;
+	}
+
+	static const char* nextLine(const char* p, const char* end) {
+		const char* eol = (const char*)std::memchr(p, '\n', end - p);
+		return eol ? eol + 1 : end;
+	}
+
+	static const char* parseFloat(const char* p, const char* end, float &value) {
+		p = skipSpaces(p, end);
+		if (p < end && *p == '+') ++p;
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc()) {
+			value = 0.0f;
+			return p;
+		}
+		return result.ptr;
+	}
+
+	// parses a 1-based, possibly negative OBJ index and makes it 0-based absolute
+	static const char* parseIndex(const char* p, const char* end, size_t current, unsigned int &index) {
+		bool negative = false;
+		if (p < end && *p == '-') {
+			negative = true;
+			++p;
+		}
+		long long value = 0;
+		const char* start = p;
+		while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+		if (p == start || value == 0) {
+			index = OBJ_NO_INDEX;
+			return p;
+		}
+		long long absolute = negative ? (long long)current - value : value - 1;
+		index = absolute < 0 ? OBJ_NO_INDEX : (unsigned int)absolute;
+		return p;
+	}
+
+	// v, v/vt, v//vn or v/vt/vn
+	static const char* parseCorner(const char* p, const char* end, size_t positionNum, size_t texcoordNum, size_t normalNum, Corner &corner) {
+		corner.Texcoord = corner.Normal = OBJ_NO_INDEX;
+		p = parseIndex(p, end, positionNum, corner.Position);
+		if (p < end && *p == '/') {
+			++p;
+			if (p < end && *p != '/') p = parseIndex(p, end, texcoordNum, corner.Texcoord);
+			if (p < end && *p == '/') p = parseIndex(p + 1, end, normalNum, corner.Normal);
+		}
+		// skip anything unexpected up to the next separator
+		while (p < end && !isSpace(*p) && *p != '\n' && *p != '\r') ++p;
+		return p;
+	}
+
+	// splits the file into line-aligned ranges of about equal size
+	static void splitChunks(const char* data, size_t size, std::vector<Chunk> &chunks) {
+		const char* begin = data;
+		const char* end = data + size;
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			const char* chunkEnd = i + 1 == chunks.size() ? end : data + size / chunks.size() * (i + 1);
+			if (chunkEnd < begin) chunkEnd = begin;
+			chunkEnd = nextLine(chunkEnd, end);
+			chunks[i].Begin = begin;
+			chunks[i].End = chunkEnd;
+			begin = chunkEnd;
+		}
+	}
+
+	template <typename Func>
+	static void parallelFor(std::vector<Chunk> &chunks, Func func) {
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < chunks.size(); ++i)
+			workers.emplace_back(func, std::ref(chunks[i]));
+		func(chunks[0]);
+		for (std::thread &worker : workers) worker.join();
+	}
+
+	bool buildVertices(std::vector<Chunk> &chunks) {
+		size_t positionNum = positions.size() / 3, texcoordNum = texcoords.size() / 2, normalNum = normals.size() / 3;
+		size_t cornerNum = 0;
+		for (Chunk &chunk : chunks) {
+			if (chunk.Error) {
+				std::cout << "ERROR::OBJ::INVALID_FACE" << std::endl;
+				return false;
+			}
+			cornerNum += chunk.Corners.size();
+		}
+
+		// every position owns a short list of the (texcoord, normal) pairs it was
+		// used with, so equal corners are found without hashing
+		struct Entry {
+			unsigned int Texcoord, Normal, Next;
+		};
+		std::vector<unsigned int> head(positionNum, OBJ_NO_INDEX);
+		std::vector<unsigned int> vertexPosition;
+		std::vector<Entry> entries;
+		entries.reserve(positionNum);
+		vertexPosition.reserve(positionNum);
+		Indices.resize(cornerNum);
+
+		bool missingNormals = false;
+		size_t k = 0;
+		for (Chunk &chunk : chunks) {
+			for (const Corner &corner : chunk.Corners) {
+				if (corner.Position >= positionNum ||
+					(corner.Texcoord != OBJ_NO_INDEX && corner.Texcoord >= texcoordNum) ||
+					(corner.Normal != OBJ_NO_INDEX && corner.Normal >= normalNum)) {
+					std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE" << std::endl;
+					return false;
+				}
+				missingNormals |= corner.Normal == OBJ_NO_INDEX;
+
+				unsigned int vertex = head[corner.Position];
+				while (vertex != OBJ_NO_INDEX &&
+					(entries[vertex].Texcoord != corner.Texcoord || entries[vertex].Normal != corner.Normal))
+					vertex = entries[vertex].Next;
+				if (vertex == OBJ_NO_INDEX) {
+					vertex = (unsigned int)entries.size();
+					entries.push_back({ corner.Texcoord, corner.Normal, head[corner.Position] });
+					vertexPosition.push_back(corner.Position);
+					head[corner.Position] = vertex;
+				}
+				Indices[k++] = vertex;
+			}
+			std::vector<Corner>().swap(chunk.Corners);
+		}
+
+		// corners without a normal get the area weighted normal of their position
+		std::vector<float> smoothNormals;
+		if (missingNormals) computeSmoothNormals(vertexPosition, smoothNormals);
+
+		Vertices.resize(entries.size() * 8);
+		for (size_t v = 0; v < entries.size(); ++v) {
+			float* out = &Vertices[v * 8];
+			const float* position = &positions[vertexPosition[v] * 3];
+			const float* normal = entries[v].Normal != OBJ_NO_INDEX ?
+				&normals[entries[v].Normal * 3] : &smoothNormals[vertexPosition[v] * 3];
+			out[0] = position[0]; out[1] = position[1]; out[2] = position[2];
+			out[3] = normal[0];   out[4] = normal[1];   out[5] = normal[2];
+			if (entries[v].Texcoord != OBJ_NO_INDEX) {
+				out[6] = texcoords[entries[v].Texcoord * 2];
+				out[7] = texcoords[entries[v].Texcoord * 2 + 1];
+			}
+			else {
+				out[6] = out[7] = 0.0f;
+			}
+		}
+
+		std::vector<float>().swap(positions);
+		std::vector<float>().swap(texcoords);
+		std::vector<float>().swap(normals);
+		return true;
+	}
+
+	void computeSmoothNormals(const std::vector<unsigned int> &vertexPosition, std::vector<float> &smoothNormals) const {
+		smoothNormals.assign(positions.size(), 0.0f);
+		for (size_t t = 0; t + 2 < Indices.size(); t += 3) {
+			unsigned int a = vertexPosition[Indices[t]], b = vertexPosition[Indices[t + 1]], c = vertexPosition[Indices[t + 2]];
+			const float* pa = &positions[a * 3];
+			const float* pb = &positions[b * 3];
+			const float* pc = &positions[c * 3];
+			float e1[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+			float e2[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+			// the cross product length is twice the area, giving the weighting for free
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			for (unsigned int p : { a, b, c })
+				for (int i = 0; i < 3; ++i) smoothNormals[p * 3 + i] += n[i];
+		}
+		for (size_t p = 0; p < smoothNormals.size(); p += 3) {
+			float* n = &smoothNormals[p];
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length > 0.0f) {
+				n[0] /= length; n[1] /= length; n[2] /= length;
+			}
+			else {
+				n[1] = 1.0f;
+			}
+		}
+	}
+};
+
+#endif // !OBJ_LOADER_H
@@ -0,0 +1,258 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "imgui.h"
+#include "trace.h"
+
+// Scopes are timed with the PROFILE_ macros. Building with PROFILER_DISABLED
+// defined turns every macro into nothing.
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#ifndef PROFILER_DISABLED
+#define PROFILE_SCOPE(name)     ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+#define PROFILE_FRAME()         Profiler::get().endFrame()
+#define PROFILE_OVERLAY()       Profiler::get().drawOverlay()
+#else
+#define PROFILE_SCOPE(name)     ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILE_FRAME()         ((void)0)
+#define PROFILE_OVERLAY()       ((void)0)
+#endif
+
+// Default profiler options
+const unsigned int PROFILER_HISTORY     = 240;   // frame times kept for the graph
+const unsigned int PROFILER_GPU_LATENCY = 3;     // frames a timer query may stay pending before its result is waited for
+const float        PROFILER_SMOOTHING   = 0.05f; // weight of a new sample in the shown averages
+
+// One scope in the tree of the scopes opened inside each other
+struct ProfileNode {
+	const char* Name;
+	int Parent;
+	unsigned int Depth;
+	float CpuTime;      // milliseconds per frame, averaged
+	float GpuTime;      // milliseconds per call, averaged, negative before the first result
+	unsigned int Calls; // in the last frame
+	double FrameCpu;    // sums of the current frame
+	unsigned int FrameCalls;
+};
+
+// Hierarchical CPU profiler with GPU timer queries for scopes that issue GL
+// work. Scopes form a tree by nesting, the tree is built once and then only
+// updated. GPU results are read back a few frames later from a pool of
+// GL_TIME_ELAPSED queries, so the CPU never waits for the GPU; as such queries
+// cannot overlap, a GPU scope inside another one is timed on the CPU only.
+//
+// Scopes are recorded on the thread that first used the profiler, the render
+// thread, and ignored elsewhere. While the Tracer captures, the scopes of all
+// threads and the GPU timings also go to the trace.
+class Profiler {
+public:
+	std::vector<ProfileNode> Nodes;
+	float History[PROFILER_HISTORY]; // frame times in milliseconds, a ring starting at historyOffset()
+
+	static Profiler &get() {
+		static Profiler profiler;
+		return profiler;
+	}
+
+	// opens a scope below the innermost open one, `name` must stay valid (a
+	// literal); returns false if the scope is not recorded
+	bool begin(const char* name, bool gpu) {
+		if (std::this_thread::get_id() != owner) return false;
+		Open scope;
+		scope.Node = find(open.empty() ? -1 : open.back().Node, name);
+		scope.Query = 0;
+		scope.TraceStart = 0;
+		if (gpu && !gpuOpen) {
+			scope.Query = query();
+			scope.TraceStart = Tracer::get().now();
+			glBeginQuery(GL_TIME_ELAPSED, scope.Query);
+			gpuOpen = true;
+		}
+		scope.Start = std::chrono::steady_clock::now();
+		open.push_back(scope);
+		return true;
+	}
+
+	// closes the innermost scope
+	void end() {
+		Open scope = open.back();
+		open.pop_back();
+		ProfileNode &node = Nodes[scope.Node];
+		node.FrameCpu += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scope.Start).count();
+		++node.FrameCalls;
+		if (scope.Query != 0) {
+			glEndQuery(GL_TIME_ELAPSED);
+			gpuOpen = false;
+			pending.push_back({ scope.Node, scope.Query, frame, scope.TraceStart });
+		}
+	}
+
+	// call once per frame outside of any scope, e.g. after swapping buffers
+	void endFrame() {
+		auto now = std::chrono::steady_clock::now();
+		History[frame % PROFILER_HISTORY] = std::chrono::duration<float, std::milli>(now - frameStart).count();
+		frameStart = now;
+		for (ProfileNode &node : Nodes) {
+			node.CpuTime += ((float)node.FrameCpu - node.CpuTime) * PROFILER_SMOOTHING;
+			node.Calls = node.FrameCalls;
+			node.FrameCpu = 0.0;
+			node.FrameCalls = 0;
+		}
+		++frame;
+		// results still missing after PROFILER_GPU_LATENCY frames are waited for
+		for (size_t i = 0; i < pending.size();) {
+			Pending &timer = pending[i];
+			GLint available = 1;
+			if (frame - timer.Frame < PROFILER_GPU_LATENCY)
+				glGetQueryObjectiv(timer.Query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				++i;
+				continue;
+			}
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(timer.Query, GL_QUERY_RESULT, &elapsed);
+			ProfileNode &node = Nodes[timer.Node];
+			float time = (float)(elapsed / 1.0e6);
+			node.GpuTime = node.GpuTime < 0.0f ? time : node.GpuTime + (time - node.GpuTime) * PROFILER_SMOOTHING;
+			Tracer::get().gpuEvent(node.Name, timer.TraceStart, elapsed);
+			queries.push_back(timer.Query);
+			pending[i] = pending.back();
+			pending.pop_back();
+		}
+		Tracer::get().endFrame();
+	}
+
+	unsigned int frameNum() const {
+		return frame;
+	}
+
+	// index of the oldest frame time in History
+	unsigned int historyOffset() const {
+		return frame % PROFILER_HISTORY;
+	}
+
+	// ImGui window with the frame time graph and the timings of every scope
+	void drawOverlay() const {
+		float last = History[(frame + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+		float highest = *std::max_element(History, History + PROFILER_HISTORY);
+		ImGui::Begin("Profiler");
+		ImGui::Text("Frame: %.3f ms (%.1f FPS)", last, last > 0.0f ? 1000.0f / last : 0.0f);
+		ImGui::PlotLines("##frame times", History, PROFILER_HISTORY, historyOffset(), NULL, 0.0f, highest * 1.2f, ImVec2(0, 60));
+		if (Tracer::get().busy()) ImGui::Text("Capturing trace...");
+		else if (ImGui::Button("Capture trace")) Tracer::get().capture();
+		ImGui::Columns(3, "scopes");
+		ImGui::Text("Scope");
+		ImGui::NextColumn();
+		ImGui::Text("CPU ms");
+		ImGui::NextColumn();
+		ImGui::Text("GPU ms");
+		ImGui::NextColumn();
+		ImGui::Separator();
+		drawNodes(-1);
+		ImGui::Columns(1);
+		ImGui::End();
+	}
+
+	// de-allocate GL objects, must be called while the context is alive
+	void release() {
+		for (const Pending &timer : pending)
+			queries.push_back(timer.Query);
+		pending.clear();
+		if (!queries.empty()) glDeleteQueries((GLsizei)queries.size(), queries.data());
+		queries.clear();
+	}
+
+private:
+	struct Open {
+		int Node;
+		GLuint Query;
+		std::chrono::steady_clock::time_point Start;
+		uint64_t TraceStart; // of GPU scopes
+	};
+
+	struct Pending {
+		int Node;
+		GLuint Query;
+		unsigned int Frame;
+		uint64_t TraceStart;
+	};
+
+	std::thread::id owner;
+	std::vector<Open> open;
+	std::vector<Pending> pending;
+	std::vector<GLuint> queries; // free timer queries
+	std::chrono::steady_clock::time_point frameStart;
+	unsigned int frame;
+	bool gpuOpen;
+
+	Profiler() : owner(std::this_thread::get_id()), frameStart(std::chrono::steady_clock::now()), frame(0), gpuOpen(false) {
+		std::fill(History, History + PROFILER_HISTORY, 0.0f);
+	}
+
+	int find(int parent, const char* name) {
+		for (size_t i = 0; i < Nodes.size(); ++i)
+			if (Nodes[i].Parent == parent && (Nodes[i].Name == name || std::strcmp(Nodes[i].Name, name) == 0))
+				return (int)i;
+		unsigned int depth = parent < 0 ? 0 : Nodes[parent].Depth + 1;
+		Nodes.push_back({ name, parent, depth, 0.0f, -1.0f, 0, 0.0, 0 });
+		return (int)Nodes.size() - 1;
+	}
+
+	GLuint query() {
+		if (queries.empty()) {
+			GLuint id;
+			glGenQueries(1, &id);
+			return id;
+		}
+		GLuint id = queries.back();
+		queries.pop_back();
+		return id;
+	}
+
+	void drawNodes(int parent) const {
+		for (size_t i = 0; i < Nodes.size(); ++i) {
+			const ProfileNode &node = Nodes[i];
+			if (node.Parent != parent) continue;
+			ImGui::Text("%*s%s", (int)node.Depth * 2, "", node.Name);
+			ImGui::NextColumn();
+			ImGui::Text("%.3f", node.CpuTime);
+			ImGui::NextColumn();
+			if (node.GpuTime < 0.0f) ImGui::Text("-");
+			else ImGui::Text("%.3f", node.GpuTime);
+			ImGui::NextColumn();
+			drawNodes((int)i);
+		}
+	}
+};
+
+// Times the enclosing block, see the PROFILE_ macros
+class ProfileScope {
+public:
+	ProfileScope(const char* name, bool gpu = false) : name(name), traced(Tracer::active()) {
+		if (traced) start = Tracer::get().now();
+		recorded = Profiler::get().begin(name, gpu);
+	}
+
+	~ProfileScope() {
+		if (recorded) Profiler::get().end();
+		if (traced) Tracer::get().event(name, start, Tracer::get().now());
+	}
+
+private:
+	const char* name;
+	bool traced, recorded;
+	uint64_t start;
+};
+
+#endif // !PROFILER_H
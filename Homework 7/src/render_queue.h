@@ -0,0 +1,159 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "shader.h"
+#include "mesh.h"
+#include "gl_state.h"
+
+// Render passes, executed in this order
+enum RenderPass {
+	RENDER_PASS_SHADOW      = 0,
+	RENDER_PASS_OPAQUE      = 1,
+	RENDER_PASS_TRANSPARENT = 2 // sorted back to front
+};
+
+// Sort key layout, from the most significant bits down: pass, program,
+// texture, VAO, depth. Draws of a pass are grouped by the most expensive
+// state first and front to back within equal state.
+const unsigned int RENDER_KEY_PASS_SHIFT    = 60; // 4 bits
+const unsigned int RENDER_KEY_PROGRAM_SHIFT = 48; // 12 bits
+const unsigned int RENDER_KEY_TEXTURE_SHIFT = 36; // 12 bits
+const unsigned int RENDER_KEY_VAO_SHIFT     = 24; // 12 bits
+const uint64_t     RENDER_KEY_NAME_MASK     = 0xFFF;
+const uint64_t     RENDER_KEY_DEPTH_MASK    = 0xFFFFFF;
+
+// Default queue options
+const char* const RENDER_MODEL_UNIFORM = "model";
+
+// One draw: the program, the texture on unit 0 (0 keeps the bound one), the
+// mesh and its model matrix
+struct DrawPacket {
+	uint64_t Key;
+	const Shader* Program;
+	const Mesh* Geometry;
+	unsigned int Texture;
+	glm::mat4 Model;
+};
+
+// Collects the draws of a frame instead of issuing them in scene order.
+// After sort() the packets of each pass are executed ordered by their keys,
+// so consecutive draws share programs, textures and VAOs and the state cache
+// skips the binds between them. Keys are radix sorted, which stays linear
+// with thousands of draws per pass.
+class RenderQueue {
+public:
+	// builds the key of a draw, `depth` is its distance from the viewer
+	static uint64_t makeKey(RenderPass pass, const Shader &program, unsigned int texture, const Mesh &geometry, float depth) {
+		// positive floats order like their bit patterns, keep the upper 24 bits
+		float positive = depth > 0.0f ? depth : 0.0f;
+		uint32_t bits;
+		std::memcpy(&bits, &positive, sizeof(bits));
+		uint64_t depthBits = (bits >> 8) & RENDER_KEY_DEPTH_MASK;
+		if (pass == RENDER_PASS_TRANSPARENT) depthBits = RENDER_KEY_DEPTH_MASK - depthBits;
+		// names are truncated, a clash only costs a few extra binds
+		return ((uint64_t)pass << RENDER_KEY_PASS_SHIFT)
+			| (((uint64_t)program.ID & RENDER_KEY_NAME_MASK) << RENDER_KEY_PROGRAM_SHIFT)
+			| (((uint64_t)texture & RENDER_KEY_NAME_MASK) << RENDER_KEY_TEXTURE_SHIFT)
+			| (((uint64_t)geometry.VAO & RENDER_KEY_NAME_MASK) << RENDER_KEY_VAO_SHIFT)
+			| depthBits;
+	}
+
+	void submit(RenderPass pass, const Shader &program, const Mesh &geometry, unsigned int texture, const glm::mat4 &model, float depth) {
+		packets.push_back({ makeKey(pass, program, texture, geometry, depth), &program, &geometry, texture, model });
+	}
+
+	// adds the packets of a queue recorded elsewhere, call before sort()
+	void append(const RenderQueue &other) {
+		packets.insert(packets.end(), other.packets.begin(), other.packets.end());
+	}
+
+	// drops the packets of the last frame, keeps the memory
+	void clear() {
+		packets.clear();
+		keys.clear();
+		order.clear();
+	}
+
+	// LSD radix sort of the keys, one byte per round. Rounds where every key
+	// has the same byte are skipped, so unused key bits cost one counting pass.
+	void sort() {
+		size_t count = packets.size();
+		keys.resize(count);
+		order.resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			keys[i] = packets[i].Key;
+			order[i] = (uint32_t)i;
+		}
+		if (count < 2) return;
+		sortedKeys.resize(count);
+		sortedOrder.resize(count);
+		for (unsigned int shift = 0; shift < 64; shift += 8) {
+			size_t offsets[256] = { 0 };
+			for (size_t i = 0; i < count; ++i)
+				++offsets[(keys[i] >> shift) & 0xFF];
+			if (offsets[(keys[0] >> shift) & 0xFF] == count) continue;
+			size_t sum = 0;
+			for (size_t &offset : offsets) {
+				size_t bucket = offset;
+				offset = sum;
+				sum += bucket;
+			}
+			// stable, so equal keys keep their submission order
+			for (size_t i = 0; i < count; ++i) {
+				size_t target = offsets[(keys[i] >> shift) & 0xFF]++;
+				sortedKeys[target] = keys[i];
+				sortedOrder[target] = order[i];
+			}
+			keys.swap(sortedKeys);
+			order.swap(sortedOrder);
+		}
+	}
+
+	// issues the sorted draws of one pass, the caller sets up its framebuffer
+	// and the textures shared by the pass
+	void execute(RenderPass pass) const {
+		uint64_t first = (uint64_t)pass << RENDER_KEY_PASS_SHIFT;
+		uint64_t last = first + ((uint64_t)1 << RENDER_KEY_PASS_SHIFT);
+		auto begin = std::lower_bound(keys.begin(), keys.end(), first);
+		auto end = pass + 1 < 16 ? std::lower_bound(begin, keys.end(), last) : keys.end();
+		GLState &state = GLState::get();
+		// the model uniform is looked up once per run of packets sharing a program
+		const std::string modelName = RENDER_MODEL_UNIFORM;
+		const Shader* program = NULL;
+		UniformHandle model;
+		for (auto it = begin; it != end; ++it) {
+			const DrawPacket &packet = packets[order[it - keys.begin()]];
+			if (packet.Program != program) {
+				program = packet.Program;
+				model = program->handle(modelName);
+				program->use();
+			}
+			if (packet.Texture != 0) state.bindTexture(0, GL_TEXTURE_2D, packet.Texture);
+			program->set(model, packet.Model);
+			packet.Geometry->draw();
+		}
+	}
+
+	unsigned int packetNum() const {
+		return (unsigned int)packets.size();
+	}
+
+private:
+	std::vector<DrawPacket> packets;
+	// sorted keys and the packet each one belongs to
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint64_t> sortedKeys;
+	std::vector<uint32_t> sortedOrder;
+};
+
+#endif // !RENDER_QUEUE_H
@@ -0,0 +1,77 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#include "shader.h"
+#include "shader_compiler.h"
+#include "shader_watcher.h"
+
+// The permutations of one program, each compiled with its own set of defines
+// the first time it is asked for. Options become compile-time constants, so a
+// variant carries no branches or loops for features it does not use.
+class ShaderVariants {
+public:
+	// called once for every variant when it becomes ready, e.g. to connect
+	// uniform blocks and samplers
+	std::function<void(Shader &)> Configure;
+
+	// with a watcher, every variant is rebuilt when its files change
+	ShaderVariants(const char* vertexPath, const char* fragmentPath, ShaderCompiler* compiler = NULL, ShaderWatcher* watcher = NULL) :
+		vertexPath(vertexPath), fragmentPath(fragmentPath), compiler(compiler), watcher(watcher) {}
+
+	// Returns the variant for `defines`. With a compiler, new variants are built
+	// in the background and NULL is returned until they are ready.
+	Shader* get(const ShaderDefines &defines) {
+		std::string name = variantName(defines);
+		auto it = variants.find(name);
+		if (it == variants.end()) {
+			std::unique_ptr<Shader> shader(new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines, compiler != NULL));
+			if (compiler != NULL) compiler->submit(*shader);
+			it = variants.emplace(name, Variant{ std::move(shader), false }).first;
+		}
+		Variant &variant = it->second;
+		if (!variant.Program->Ready) return NULL;
+		if (!variant.Configured) {
+			variant.Configured = true;
+			if (Configure) Configure(*variant.Program);
+			if (watcher != NULL) watcher->watch(*variant.Program, Configure);
+			variant.Program->printStats(fragmentPath + " [" + name + "]");
+		}
+		return variant.Program.get();
+	}
+
+	unsigned int variantNum() const {
+		return (unsigned int)variants.size();
+	}
+
+	// de-allocate every variant, must be called while the context is alive
+	void release() {
+		for (auto &variant : variants)
+			variant.second.Program->release();
+		variants.clear();
+	}
+
+private:
+	struct Variant {
+		std::unique_ptr<Shader> Program;
+		bool Configured;
+	};
+
+	std::string vertexPath, fragmentPath;
+	ShaderCompiler* compiler;
+	ShaderWatcher* watcher;
+	std::unordered_map<std::string, Variant> variants;
+
+	static std::string variantName(const ShaderDefines &defines) {
+		std::string name;
+		for (const auto &define : defines)
+			name += (name.empty() ? "" : " ") + define.first + "=" + define.second;
+		return name;
+	}
+};
+
+#endif // !SHADER_VARIANTS_H
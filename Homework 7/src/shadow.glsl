@@ -0,0 +1,43 @@
+// Shadow map lookup, configured per program variant:
+//   SHADOWS   0 disables shadows (and the shadow map lookups) entirely
+//   PCF_SIZE  width of the square percentage closer filtering kernel, odd
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+#ifndef PCF_SIZE
+#define PCF_SIZE 3
+#endif
+
+#if SHADOWS
+uniform sampler2D shadowMap;
+#endif
+
+// fraction of the light blocked at a fragment, 0 = fully lit
+float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
+#if SHADOWS
+    // perform perspective divide (though orthographic doesn't need it)
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    // transform to [0,1] range
+    projCoords = projCoords * 0.5 + 0.5;
+    // get depth of current fragment from light's perspective
+    float currentDepth = projCoords.z;
+    if (currentDepth > 1.0)
+        return 0.0;
+    // to solve the issue of Shadow Acne, we'll shadow bias
+    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+
+    // average the depth tests of the kernel around the fragment
+    const int radius = PCF_SIZE / 2;
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    for (int x = -radius; x <= radius; ++x) {
+        for (int y = -radius; y <= radius; ++y) {
+            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+    return shadow / float(PCF_SIZE * PCF_SIZE);
+#else
+    return 0.0;
+#endif
+}
\ No newline at end of file
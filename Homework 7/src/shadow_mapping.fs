@@ -9,45 +9,13 @@ in VS_OUT {
 } fs_in;
 
 uniform sampler2D woodTexture;
-uniform sampler2D shadowMap;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
-    // perform perspective divide (though orthographic doesn't need it)
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    // transform to [0,1] range
-    projCoords = projCoords * 0.5 + 0.5;
-    // get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
-    // get depth of current fragment from light's perspective
-    float currentDepth = projCoords.z;
-	// to solve the issue of Shadow Acne, we'll shadow bias
-	float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-    // check whether current frag pos is in shadow
-    // float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
-
-	float shadow = 0.0;
-
-	if (currentDepth <= 1.0) {
-		vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-		for(int x = -1; x <= 1; ++x) {
-			for(int y = -1; y <= 1; ++y) {
-				float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
-				shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;        
-			}    
-		}
-		shadow /= 9.0;
-	}
-
-    return shadow;
-}
+#include "blocks.glsl"
+#include "shadow.glsl"
 
 void main() {           
     vec3 color = texture(woodTexture, fs_in.TexCoords).rgb;
     vec3 normal = normalize(fs_in.Normal);
-    vec3 lightColor = vec3(0.3);
 
     // ambient
     vec3 ambient = 0.3 * color;
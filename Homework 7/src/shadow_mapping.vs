@@ -12,10 +12,9 @@ out VS_OUT {
     vec4 FragPosLightSpace;
 } vs_out;
 
-uniform mat4 proj;
-uniform mat4 view;
+#include "blocks.glsl"
+
 uniform mat4 model;
-uniform mat4 lightSpaceMatrix;
 
 void main() {
     vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
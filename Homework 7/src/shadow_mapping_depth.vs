@@ -1,7 +1,8 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 lightSpaceMatrix;
+#include "blocks.glsl"
+
 uniform mat4 model;
 
 void main() {
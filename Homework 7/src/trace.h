@@ -0,0 +1,175 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+// Default trace options
+const unsigned int TRACE_CAPTURE_FRAMES = 120;     // frames recorded by one capture
+const unsigned int TRACE_FLUSH_FRAMES   = 4;       // frames waited for late GPU timings before writing
+const unsigned int TRACE_BUFFER_EVENTS  = 1 << 15; // events kept per thread, a power of two
+const unsigned int TRACE_GPU_THREAD     = 0;       // thread id of the GPU track
+
+// A finished scope, times in nanoseconds since the tracer started
+struct TraceEvent {
+	const char* Name;
+	uint64_t Start;
+	uint64_t Duration;
+};
+
+// Events of one thread. Only the owning thread writes, so pushing is a store
+// and a release increment; the newest TRACE_BUFFER_EVENTS events are kept.
+struct TraceBuffer {
+	unsigned int Thread;
+	std::string Name;
+	TraceEvent Events[TRACE_BUFFER_EVENTS];
+	std::atomic<uint64_t> Head;
+
+	TraceBuffer(unsigned int thread, const std::string &name) : Thread(thread), Name(name), Head(0) {}
+
+	void push(const TraceEvent &event) {
+		uint64_t head = Head.load(std::memory_order_relaxed);
+		Events[head & (TRACE_BUFFER_EVENTS - 1)] = event;
+		Head.store(head + 1, std::memory_order_release);
+	}
+};
+
+// Captures the profiler scopes of a number of frames on all threads and
+// writes them as Chrome trace events (chrome://tracing, ui.perfetto.dev).
+//
+// Every thread records into its own ring buffer, so capturing takes no lock
+// after the first event of a thread. GPU timings arrive frames late through
+// the profiler; they are drawn on their own track at the CPU start of their
+// scope, since timer queries only measure durations.
+class Tracer {
+public:
+	static Tracer &get() {
+		static Tracer tracer;
+		return tracer;
+	}
+
+	// starts recording, the file is written TRACE_FLUSH_FRAMES after the last frame
+	void capture(unsigned int frames = TRACE_CAPTURE_FRAMES) {
+		if (capturing.load(std::memory_order_relaxed) || flushing > 0) return;
+		remaining = frames;
+		captureStart = now();
+		capturing.store(true, std::memory_order_release);
+	}
+
+	bool busy() const {
+		return capturing.load(std::memory_order_relaxed) || flushing > 0;
+	}
+
+	static bool active() {
+		return get().capturing.load(std::memory_order_acquire);
+	}
+
+	// nanoseconds since the tracer started
+	uint64_t now() const {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	// names the calling thread in the trace, call before its first event
+	void nameThread(const std::string &name) {
+		buffer(name);
+	}
+
+	// records a CPU scope of the calling thread, `name` must stay valid (a literal)
+	void event(const char* name, uint64_t start, uint64_t end) {
+		if (!capturing.load(std::memory_order_relaxed)) return;
+		buffer("").push({ name, start, end - start });
+	}
+
+	// records a GPU timing measured for a scope that started at `start`,
+	// called from the render thread
+	void gpuEvent(const char* name, uint64_t start, uint64_t duration) {
+		if (!busy() || start < captureStart) return;
+		if (!capturing.load(std::memory_order_relaxed) && start > captureEnd) return;
+		gpu.push({ name, start, duration });
+	}
+
+	// call once per frame on the render thread, writes the capture when done
+	void endFrame() {
+		if (capturing.load(std::memory_order_relaxed)) {
+			if (remaining > 0) --remaining;
+			if (remaining == 0) {
+				captureEnd = now();
+				capturing.store(false, std::memory_order_release);
+				flushing = TRACE_FLUSH_FRAMES;
+			}
+			return;
+		}
+		if (flushing > 0 && --flushing == 0) write();
+	}
+
+private:
+	std::chrono::steady_clock::time_point epoch;
+	std::atomic<bool> capturing;
+	unsigned int remaining;
+	unsigned int flushing;
+	uint64_t captureStart, captureEnd;
+	unsigned int captures;
+	// one buffer per thread that recorded, the GPU track apart
+	std::mutex mutex;
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+	TraceBuffer gpu;
+
+	Tracer() : epoch(std::chrono::steady_clock::now()), capturing(false), remaining(0), flushing(0),
+		captureStart(0), captureEnd(0), captures(0), gpu(TRACE_GPU_THREAD, "GPU") {}
+
+	TraceBuffer &buffer(const std::string &name) {
+		thread_local TraceBuffer* local = NULL;
+		if (local == NULL) {
+			std::lock_guard<std::mutex> lock(mutex);
+			unsigned int thread = (unsigned int)buffers.size() + 1;
+			buffers.emplace_back(new TraceBuffer(thread, name.empty() ? "thread " + std::to_string(thread) : name));
+			local = buffers.back().get();
+		}
+		return *local;
+	}
+
+	void writeEvents(std::ofstream &file, const TraceBuffer &buffer, bool &first) const {
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.Thread
+			<< ",\"args\":{\"name\":\"" << buffer.Name << "\"}}";
+		first = false;
+		uint64_t head = buffer.Head.load(std::memory_order_acquire);
+		uint64_t count = head < TRACE_BUFFER_EVENTS ? head : TRACE_BUFFER_EVENTS;
+		for (uint64_t i = head - count; i < head; ++i) {
+			const TraceEvent &event = buffer.Events[i & (TRACE_BUFFER_EVENTS - 1)];
+			if (event.Start < captureStart || event.Start > captureEnd) continue;
+			// Chrome expects microseconds
+			file << ",\n{\"name\":\"" << event.Name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.Thread
+				<< ",\"ts\":" << event.Start / 1000.0 << ",\"dur\":" << event.Duration / 1000.0 << "}";
+		}
+	}
+
+	void write() {
+		std::string path = "trace_" + std::to_string(++captures) + ".json";
+		std::ofstream file(path);
+		if (!file) {
+			std::cout << "ERROR::TRACE::FILE_NOT_WRITTEN: " << path << std::endl;
+			return;
+		}
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		file << "{\"traceEvents\":[\n";
+		bool first = true;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto &buffer : buffers)
+				writeEvents(file, *buffer, first);
+		}
+		writeEvents(file, gpu, first);
+		file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		std::cout << "TRACE::" << path << ": " << (captureEnd - captureStart) / 1.0e6 << " ms captured" << std::endl;
+	}
+};
+
+#endif // !TRACE_H
@@ -0,0 +1,82 @@
+#ifndef UNIFORM_BLOCK_H
+#define UNIFORM_BLOCK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+
+#include "shader.h"
+#include "gl_resources.h"
+
+// Uniform buffer binding points shared by all programs
+const unsigned int CAMERA_BINDING = 1;
+const unsigned int LIGHT_BINDING  = 2;
+
+// std140 layout of the Camera block
+struct CameraBlock {
+	glm::mat4 Proj;
+	glm::mat4 View;
+	glm::vec4 ViewPos; // xyz used
+};
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match the std140 layout of Camera");
+
+// std140 layout of the Light block
+struct LightBlock {
+	glm::mat4 LightSpaceMatrix;
+	glm::vec4 LightPos;   // xyz used
+	glm::vec4 LightColor; // xyz used
+};
+static_assert(sizeof(LightBlock) == 96, "LightBlock must match the std140 layout of Light");
+
+// A uniform buffer holding one block of per-frame data. Programs are connected
+// to its binding point once after linking, the data is uploaded once per frame
+// instead of setting the same uniforms on every program.
+template <typename T>
+class UniformBlock {
+public:
+	T Data;
+	unsigned int UBO;
+	BufferHandle Buffer; // UBO in the GLResources pool
+	unsigned int Binding;
+
+	UniformBlock(unsigned int binding) : Data(), UBO(0), Binding(binding) {
+		Buffer = GLResources::get().createBuffer();
+		UBO = GLResources::get().name(Buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		GLResources::get().setMemory(Buffer, sizeof(T));
+		glBindBufferBase(GL_UNIFORM_BUFFER, Binding, UBO);
+	}
+
+	// connects the block `name` of a shader to the buffer, programs not using
+	// the block are left alone
+	void bind(const Shader &shader, const char* name) const {
+		unsigned int index = glGetUniformBlockIndex(shader.ID, name);
+		if (index == GL_INVALID_INDEX) return;
+		GLint size = 0;
+		glGetActiveUniformBlockiv(shader.ID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+		if (size > (GLint)sizeof(T)) {
+			std::cout << "ERROR::UNIFORM_BLOCK::SIZE_MISMATCH: " << name << " needs " << size << " bytes" << std::endl;
+			return;
+		}
+		glUniformBlockBinding(shader.ID, index, Binding);
+	}
+
+	// uploads Data, call once per frame before drawing
+	void upload() const {
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &Data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, Binding, UBO);
+	}
+
+	// de-allocate GL objects, must be called while the context is alive
+	void release() {
+		GLResources::get().destroy(Buffer);
+		UBO = 0;
+	}
+};
+
+#endif // !UNIFORM_BLOCK_H
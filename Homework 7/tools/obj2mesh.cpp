@@ -0,0 +1,41 @@
+// obj2mesh: converts Wavefront OBJ files to the binary mesh cache read by HW7.
+//
+// usage: obj2mesh <input.obj> [output.mesh]
+// The output defaults to `<input.obj>.mesh`, the path HW7 looks for first.
+
+#include "../src/mesh.h"
+#include "../src/obj_loader.h"
+#include "../src/mesh_cache.h"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		std::cout << "usage: obj2mesh <input.obj> [output.mesh]" << std::endl;
+		return 1;
+	}
+	std::string input = argv[1];
+	std::string output = argc > 2 ? argv[2] : input + ".mesh";
+
+	ObjLoader loader(input.c_str());
+	if (!loader.Loaded) return 1;
+	loader.printStats(input);
+
+	// store the index buffer already reordered for the vertex cache
+	unsigned int vertexCount = (unsigned int)(loader.Vertices.size() / 8);
+	float before = Mesh::computeACMR(loader.Indices, vertexCount);
+	Mesh::optimizeVertexCache(loader.Indices, vertexCount);
+	float after = Mesh::computeACMR(loader.Indices, vertexCount);
+	std::cout << "ACMR " << before << " -> " << after << std::endl;
+
+	if (!saveMeshCache(output.c_str(), loader.Vertices.data(), vertexCount,
+		loader.Indices.data(), (uint32_t)loader.Indices.size(), { 3, 3, 2 }))
+		return 1;
+
+	// read it back to make sure the file is usable
+	MeshCache cache(output.c_str());
+	if (!cache.Loaded) return 1;
+	cache.printStats(output);
+	return 0;
+}
@@ -0,0 +1,174 @@
+#ifndef DYNAMIC_BUFFER_H
+#define DYNAMIC_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+#include "gl_resources.h"
+
+// Default dynamic buffer options
+const float DYNAMIC_BUFFER_ORPHAN_RATIO = 0.5f; // dirty share of the used bytes above which the whole buffer is re-specified
+
+// Vertex buffer whose contents change while the application runs.
+//
+// The VAO and the attribute layout are set up once on construction; later
+// frames only hand the new vertices to set(). A CPU copy of the contents is
+// compared against them, and upload() sends just the bytes between the first
+// and the last one that changed with glBufferSubData, so a frame that changes
+// nothing uploads nothing. When the buffer has to grow, or most of it changed,
+// the storage is orphaned with glBufferData(NULL) instead and filled again, so
+// the driver hands out fresh memory rather than waiting for draws still
+// reading the old contents.
+//
+// Use GL_DYNAMIC_DRAW for data changed now and then and drawn many times, and
+// GL_STREAM_DRAW for data rewritten about every frame.
+class DynamicBuffer {
+public:
+	unsigned int VAO, VBO, EBO;
+	// the same objects in the GLResources pool
+	VertexArrayHandle VertexArray;
+	BufferHandle VertexBuffer, ElementBuffer;
+	// number of floats of each attribute, e.g. {3, 3} for position/color
+	std::vector<int> Layout;
+	unsigned int Stride;
+	GLenum Usage;
+	// bytes allocated on the GPU and bytes in use
+	size_t Capacity, Size;
+	// bytes sent by the last upload() and since construction
+	size_t Uploaded, TotalUploaded;
+
+	DynamicBuffer() : VAO(0), VBO(0), EBO(0), Stride(0), Usage(GL_DYNAMIC_DRAW), Capacity(0), Size(0),
+		Uploaded(0), TotalUploaded(0), dirtyBegin(0), dirtyEnd(0) {}
+
+	// creates the VAO and links the interleaved float attributes of `layout`
+	// to locations 0, 1, ...; `capacity` bytes are reserved up front
+	DynamicBuffer(const std::vector<int> &layout, GLenum usage = GL_DYNAMIC_DRAW, size_t capacity = 0) : DynamicBuffer() {
+		Layout = layout;
+		for (int size : Layout) Stride += size;
+		Usage = usage;
+
+		GLResources &resources = GLResources::get();
+		VertexArray = resources.createVertexArray();
+		VertexBuffer = resources.createBuffer();
+		VAO = resources.name(VertexArray);
+		VBO = resources.name(VertexBuffer);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		if (capacity > 0) {
+			glBufferData(GL_ARRAY_BUFFER, capacity, NULL, Usage);
+			Capacity = capacity;
+			resources.setMemory(VertexBuffer, Capacity);
+		}
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < Layout.size(); ++i) {
+			glVertexAttribPointer(i, Layout[i], GL_FLOAT, GL_FALSE, Stride * sizeof(float), (void*)(offset * sizeof(float)));
+			glEnableVertexAttribArray(i);
+			offset += Layout[i];
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// attaches a static index buffer to the VAO
+	void setIndices(const unsigned int* indices, unsigned int count) {
+		GLResources &resources = GLResources::get();
+		glBindVertexArray(VAO);
+		if (EBO == 0) {
+			ElementBuffer = resources.createBuffer();
+			EBO = resources.name(ElementBuffer);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+		resources.setMemory(ElementBuffer, count * sizeof(unsigned int));
+		glBindVertexArray(0);
+	}
+
+	// replaces the contents with `size` bytes, only bytes that differ from the
+	// current contents are marked for upload
+	void set(const void* data, size_t size) {
+		write(0, data, size);
+		if (size < Size) Size = size;
+	}
+
+	// overwrites `size` bytes at `offset`, the contents grow if needed
+	void write(size_t offset, const void* data, size_t size) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		if (offset + size > Size) {
+			// new bytes are dirty whatever they hold
+			markDirty(Size > offset ? Size : offset, offset + size);
+			if (shadow.size() < offset + size) shadow.resize(offset + size);
+			Size = offset + size;
+		}
+		// narrow the compared range down to the bytes that changed
+		size_t first = 0, last = size;
+		while (first < last && shadow[offset + first] == bytes[first]) ++first;
+		while (last > first && shadow[offset + last - 1] == bytes[last - 1]) --last;
+		if (first == last) return;
+		std::memcpy(shadow.data() + offset + first, bytes + first, last - first);
+		markDirty(offset + first, offset + last);
+	}
+
+	// sends the changed bytes to the GPU, call before drawing
+	void upload() {
+		Uploaded = 0;
+		if (dirtyEnd > Size) dirtyEnd = Size;
+		if (dirtyBegin >= dirtyEnd) return;
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		if (Size > Capacity || dirtyEnd - dirtyBegin > Size * DYNAMIC_BUFFER_ORPHAN_RATIO) {
+			// grow geometrically so streaming data does not reallocate every frame
+			if (Size > Capacity) Capacity = Size > 2 * Capacity ? Size : 2 * Capacity;
+			glBufferData(GL_ARRAY_BUFFER, Capacity, NULL, Usage);
+			GLResources::get().setMemory(VertexBuffer, Capacity);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, Size, shadow.data());
+			Uploaded = Size;
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin, dirtyEnd - dirtyBegin, shadow.data() + dirtyBegin);
+			Uploaded = dirtyEnd - dirtyBegin;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		TotalUploaded += Uploaded;
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	void bind() const {
+		glBindVertexArray(VAO);
+	}
+
+	// vertices in use
+	unsigned int vertexNum() const {
+		return Stride == 0 ? 0 : (unsigned int)(Size / (Stride * sizeof(float)));
+	}
+
+	// de-allocate GL objects, must be called while the context is alive. They
+	// are deleted once the frames drawing them are done, see GLResources
+	void release() {
+		GLResources &resources = GLResources::get();
+		resources.destroy(VertexArray);
+		resources.destroy(VertexBuffer);
+		resources.destroy(ElementBuffer);
+		VAO = VBO = EBO = 0;
+		Capacity = Size = 0;
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+private:
+	// contents as last set, the GPU copy matches it outside the dirty range
+	std::vector<unsigned char> shadow;
+	size_t dirtyBegin, dirtyEnd;
+
+	void markDirty(size_t begin, size_t end) {
+		if (dirtyBegin >= dirtyEnd) {
+			dirtyBegin = begin;
+			dirtyEnd = end;
+			return;
+		}
+		if (begin < dirtyBegin) dirtyBegin = begin;
+		if (end > dirtyEnd) dirtyEnd = end;
+	}
+};
+
+#endif // !DYNAMIC_BUFFER_H
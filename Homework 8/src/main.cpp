@@ -9,6 +9,12 @@
 #include <math.h>
 #include <vector>
 
+#include "timestep.h"
+#include "headless.h"
+#include "frame_capture.h"
+#include "dynamic_buffer.h"
+#include "gl_resources.h"
+
 struct Point {
 	float x;
 	float y;
@@ -18,7 +24,7 @@ struct Point {
 const unsigned int WIDTH = 800;
 const unsigned int HEIGHT = 600;
 const unsigned int NUM_POINT_TO_PAINT = 100;
-const unsigned int UPDATE_EVERY = 50;
+const unsigned int UPDATE_EVERY = 50; // simulation ticks per progress point
 
 const char* glsl_version = "#version 330 core";
 
@@ -50,12 +56,14 @@ void cursor_position_callback(GLFWwindow* window, double x, double y);
 
 float Bernstein(float t, int i, int n);
 
-int main() {
+int main(int argc, char* argv[]) {
 	//----------------------------------------------------------------
 	// Initialize and configure GLFW
 	// Version: 3.3
 	// Profile: CORE
-	glfwInit();
+	// --headless renders offscreen without a display, see headless.h
+	Headless headless(argc, argv, WIDTH, HEIGHT);
+	headless.init();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -63,7 +71,7 @@ int main() {
 	// Create GLFW window
 	// Width:  800
 	// Height: 600
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Bezier Curve", NULL, NULL);
+	GLFWwindow* window = headless.createWindow(WIDTH, HEIGHT, "Bezier Curve");
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window." << std::endl;
 		glfwTerminate();
@@ -80,6 +88,17 @@ int main() {
 		return -1;
 	}
 
+	// GL objects are pooled and counted, deleted once the GPU is done with them
+	GLResources &resources = GLResources::get();
+
+	// offscreen framebuffer of the headless mode
+	if (!headless.setup()) {
+		glfwTerminate();
+		return -1;
+	}
+	// --capture DIR writes every frame to DIR, see frame_capture.h
+	FrameCapture capture(headless.Arguments, headless.width(), headless.height());
+
 	// Setup ImGui Context
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -93,9 +112,11 @@ int main() {
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
 	ImGui_ImplOpenGL3_Init(glsl_version);
 	
-	unsigned int VAOs[2], VBOs[2];
-	glGenVertexArrays(2, VAOs);
-	glGenBuffers(2, VBOs);
+	// position/color vertices; points only change on clicks, the construction
+	// levels and the curve change every tick while the progress is shown
+	DynamicBuffer pointBuffer({ 3, 3 }, GL_DYNAMIC_DRAW);
+	DynamicBuffer levelBuffer({ 3, 3 }, GL_STREAM_DRAW);
+	DynamicBuffer curveBuffer({ 3, 3 }, GL_STREAM_DRAW, (NUM_POINT_TO_PAINT + 1) * 6 * sizeof(float));
 
 	// build and compile shader program
 	// -------------------- vertex shader ---------------------------
@@ -119,7 +140,8 @@ int main() {
 		std::cout << "ERROR: FRAGMENT SHADER COMPILATION FAILED!\n" << infoLog << std::endl;
 	}
 	// --------------------- shader program ---------------------------
-	int shaderProgram = glCreateProgram();
+	ProgramHandle program = resources.createProgram();
+	int shaderProgram = resources.name(program);
 	glAttachShader(shaderProgram, vertexShader);
 	glAttachShader(shaderProgram, fragmentShader);
 	glLinkProgram(shaderProgram);
@@ -136,7 +158,11 @@ int main() {
 
 	// Curve/Point vertices for painting
 	float curveVertices[(NUM_POINT_TO_PAINT + 1) * 6];
-	float pointVertices[(NUM_POINT_TO_PAINT + 1) * 6];
+	std::vector<float> pointVertices, levelVertices;
+	// first vertex and vertex count of every level of the progress construction
+	std::vector<int> levelFirst, levelCount;
+	// bytes sent to the GPU by all buffers, in total and in the last frame
+	size_t uploadedTotal = 0, uploadedLastFrame = 0;
 
 	// drawType
 	// false: for immediately show
@@ -146,7 +172,12 @@ int main() {
 	int counter = 0;
 	float T = 0.0f;
 
+	// progress animation runs on fixed simulation ticks, independent of frame rate
+	FixedTimestep timestep;
+
 	while (!glfwWindowShouldClose(window)) {
+		headless.beginFrame();
+		int steps = timestep.advance(glfwGetTime());
 		processInput(window);
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
@@ -160,6 +191,7 @@ int main() {
 		ImGui::Text("+-------------------------------+");
 
 		ImGui::Checkbox("Show Progress", &showProgress);
+		ImGui::Text("Uploaded last frame: %zu bytes", uploadedLastFrame);
 		ImGui::End();
 
 		// ----------------------------------------------------
@@ -167,24 +199,17 @@ int main() {
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		// Set up vertices
+		pointVertices.clear();
 		for (int i = 0; i < points.size(); ++i) {
-			pointVertices[6 * i + 0] = points[i].x;
-			pointVertices[6 * i + 1] = points[i].y;
-			pointVertices[6 * i + 2] = 0.0f;
 			// color: (255, 255, 255) -> white
-			pointVertices[6 * i + 3] = 1.0f;
-			pointVertices[6 * i + 4] = 1.0f;
-			pointVertices[6 * i + 5] = 1.0f;
+			float vertex[6] = { points[i].x, points[i].y, 0.0f, 1.0f, 1.0f, 1.0f };
+			pointVertices.insert(pointVertices.end(), vertex, vertex + 6);
 		}
 
 		// for point
-		glBindVertexArray(VAOs[0]);
-		glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
-		glBufferData(GL_ARRAY_BUFFER, points.size() * 6 * sizeof(float), pointVertices, GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
+		pointBuffer.set(pointVertices.data(), pointVertices.size() * sizeof(float));
+		pointBuffer.upload();
+		pointBuffer.bind();
 		glPointSize(16);
 		glDrawArrays(GL_POINTS, 0, points.size());
 		glDrawArrays(GL_LINE_STRIP, 0, points.size());
@@ -210,24 +235,26 @@ int main() {
 			}
 
 			// for curve
-			glBindVertexArray(VAOs[1]);
-			glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
-			glBufferData(GL_ARRAY_BUFFER, (NUM_POINT_TO_PAINT + 1) * 6 * sizeof(float), curveVertices, GL_STATIC_DRAW);
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-			glEnableVertexAttribArray(1);
+			curveBuffer.set(curveVertices, (NUM_POINT_TO_PAINT + 1) * 6 * sizeof(float));
+			curveBuffer.upload();
+			curveBuffer.bind();
 			glDrawArrays(GL_LINE_STRIP, 0, NUM_POINT_TO_PAINT + 1);
 		}
 		else {
-			if (counter % UPDATE_EVERY == 0) {
-				T = (float)counter / (NUM_POINT_TO_PAINT * UPDATE_EVERY);
+			for (int i = 0; i < steps; ++i) {
+				if (counter % UPDATE_EVERY == 0) {
+					T = (float)counter / (NUM_POINT_TO_PAINT * UPDATE_EVERY);
+				}
+				counter += 1;
+				if (counter > NUM_POINT_TO_PAINT * UPDATE_EVERY) counter = 1;
 			}
-			counter += 1;
-			if (counter > NUM_POINT_TO_PAINT * UPDATE_EVERY) counter = 1;
 			
 			std::vector<Point> tmpPoints1(points);
 
+			// all levels go into one upload, each is drawn from its own range
+			levelVertices.clear();
+			levelFirst.clear();
+			levelCount.clear();
 			while (tmpPoints1.size() > 1) {
 				int pointsCounter = 0;
 				std::vector<Point> tmpPoints2;
@@ -239,31 +266,27 @@ int main() {
 						tmpX = b0 * tmpPoints1[i].x + b1 * tmpPoints1[i + 1].x,
 						tmpY = b0 * tmpPoints1[i].y + b1 * tmpPoints1[i + 1].y;
 					tmpPoints2.push_back(Point(tmpX, tmpY));
-					pointVertices[6 * pointsCounter + 0] = tmpX;
-					pointVertices[6 * pointsCounter + 1] = tmpY;
-					pointVertices[6 * pointsCounter + 2] = 0.0f;
 					// color: (0, 255, 0) -> green
-					pointVertices[6 * pointsCounter + 3] = 0.0f;
-					pointVertices[6 * pointsCounter + 4] = 1.0f;
-					pointVertices[6 * pointsCounter + 5] = 0.0f;
+					float vertex[6] = { tmpX, tmpY, 0.0f, 0.0f, 1.0f, 0.0f };
+					levelVertices.insert(levelVertices.end(), vertex, vertex + 6);
 					pointsCounter += 1;
 				}
-
-				// for point
-				glBindVertexArray(VAOs[0]);
-				glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
-				glBufferData(GL_ARRAY_BUFFER, pointsCounter * 6 * sizeof(float), pointVertices, GL_STATIC_DRAW);
-				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-				glEnableVertexAttribArray(1);
-				glPointSize(4);
-				glDrawArrays(GL_POINTS, 0, pointsCounter);
-				glDrawArrays(GL_LINE_STRIP, 0, pointsCounter);
+				levelFirst.push_back((int)levelVertices.size() / 6 - pointsCounter);
+				levelCount.push_back(pointsCounter);
 
 				tmpPoints1.assign(tmpPoints2.begin(), tmpPoints2.end());
 			}
 
+			// for the levels
+			levelBuffer.set(levelVertices.data(), levelVertices.size() * sizeof(float));
+			levelBuffer.upload();
+			levelBuffer.bind();
+			glPointSize(4);
+			for (size_t i = 0; i < levelCount.size(); ++i) {
+				glDrawArrays(GL_POINTS, levelFirst[i], levelCount[i]);
+				glDrawArrays(GL_LINE_STRIP, levelFirst[i], levelCount[i]);
+			}
+
 			
 			for (int j = 0; j <= counter/UPDATE_EVERY; ++j) {
 				float t = (float)j / NUM_POINT_TO_PAINT;
@@ -284,28 +307,41 @@ int main() {
 			}
 
 			// for curve
-			glBindVertexArray(VAOs[1]);
-			glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
-			glBufferData(GL_ARRAY_BUFFER, (counter / UPDATE_EVERY + 1) * 6 * sizeof(float), curveVertices, GL_STATIC_DRAW);
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-			glEnableVertexAttribArray(1);
+			curveBuffer.set(curveVertices, (counter / UPDATE_EVERY + 1) * 6 * sizeof(float));
+			curveBuffer.upload();
+			curveBuffer.bind();
 			glDrawArrays(GL_LINE_STRIP, 0, counter / UPDATE_EVERY + 1);
 		}
+
+		// a buffer not uploaded this frame keeps its last Uploaded, count totals instead
+		size_t total = pointBuffer.TotalUploaded + levelBuffer.TotalUploaded + curveBuffer.TotalUploaded;
+		uploadedLastFrame = total - uploadedTotal;
+		uploadedTotal = total;
 		
 
+		// read the frame back before the UI is drawn over it
+		capture.capture();
+
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+		resources.endFrame();
+
 		// swap buffers and poll IO events
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		headless.endFrame(window);
 	}
 
 	// cleanup
-	glDeleteVertexArrays(2, VAOs);
-	glDeleteBuffers(2, VBOs);
+	pointBuffer.release();
+	levelBuffer.release();
+	curveBuffer.release();
+	capture.release();
+	resources.destroy(program);
+	headless.release();
+	// anything still alive now is reported as a leak
+	resources.release();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
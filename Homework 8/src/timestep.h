@@ -0,0 +1,88 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+// Default fixed timestep options
+const double TIMESTEP  = 1.0 / 60.0; // length of one simulation tick (seconds)
+const double MAX_FRAME = 0.25;       // longest frame we try to catch up on (seconds)
+const int    MAX_STEPS = 8;          // upper bound of simulation ticks per rendered frame
+
+// Decouples simulation from rendering: the simulation is advanced in ticks of
+// constant length, while rendering interpolates between the last two ticks.
+//
+// Usage in a render loop:
+//     int steps = timestep.advance(glfwGetTime());
+//     for (int i = 0; i < steps; ++i) { previous = current; update(current, timestep.Step); }
+//     render(timestep.interpolate(previous, current));
+class FixedTimestep {
+public:
+	// Timestep options
+	double Step;
+	double MaxFrame;
+	int    MaxSteps;
+	// Simulation time after the last completed tick
+	double SimTime;
+	// Ticks run since construction
+	unsigned long long Ticks;
+
+	FixedTimestep(
+		double step = TIMESTEP,
+		double maxFrame = MAX_FRAME,
+		int maxSteps = MAX_STEPS
+	) :
+		Step(step),
+		MaxFrame(maxFrame),
+		MaxSteps(maxSteps),
+		SimTime(0.0),
+		Ticks(0),
+		accumulator(0.0),
+		lastTime(-1.0)
+	{
+	}
+
+	// Feeds the wall-clock time of the current frame and returns the number of
+	// simulation ticks that have to be run before rendering it.
+	// Long frames are clamped so a slow frame can never trigger an ever growing
+	// amount of catch-up work (the "spiral of death").
+	int advance(double now) {
+		if (lastTime < 0.0) lastTime = now;
+		double frameTime = now - lastTime;
+		lastTime = now;
+		if (frameTime > MaxFrame) frameTime = MaxFrame;
+		if (frameTime < 0.0)      frameTime = 0.0;
+
+		accumulator += frameTime;
+		int steps = 0;
+		while (accumulator >= Step && steps < MaxSteps) {
+			accumulator -= Step;
+			SimTime += Step;
+			++Ticks;
+			++steps;
+		}
+		// drop the time we refused to simulate instead of carrying it over
+		if (steps == MaxSteps && accumulator >= Step) accumulator = 0.0;
+		return steps;
+	}
+
+	// Interpolation factor in [0, 1) between the previous and the current tick
+	float alpha() const {
+		return (float)(accumulator / Step);
+	}
+
+	// Simulation time to render at, lagging at most one tick behind SimTime
+	double renderTime() const {
+		double t = SimTime - Step + accumulator;
+		return t > 0.0 ? t : 0.0;
+	}
+
+	// Blends the state of the previous tick with the state of the current tick
+	template <typename T>
+	T interpolate(const T &previous, const T &current) const {
+		return previous + (current - previous) * alpha();
+	}
+
+private:
+	double accumulator;
+	double lastTime;
+};
+
+#endif // !TIMESTEP_H
@@ -0,0 +1,158 @@
+// benchmark: runs every homework scene headless and collects its frame times.
+//
+// usage: benchmark [--bin DIR] [--warmup N] [--frames M] [--size WxH] [--output FILE] [homework...]
+// Run from the repository root. The scenes are the executables HW2 ... HW8
+// (HW2.exe ... on Windows) in DIR, `build` by default; each one is started in
+// its `Homework N/src` directory, where its shaders and assets are found, as
+//   HWn --headless --warmup N --frames M [--size WxH] --bench FILE
+// Every scene writes the mean, p50, p99 and max of its CPU and GPU frame
+// times in milliseconds, see headless.h. The results of all scenes are
+// printed, or written to FILE, as one JSON document together with the
+// commit, so runs can be compared across commits and machines. Listing
+// homework numbers, e.g. `benchmark 5 7`, runs only those scenes. HW5 is run
+// three times: its default view and the split screen drawn in one multiview
+// pass and in one pass per view.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+
+struct Scene {
+	unsigned int Homework;
+	const char* Name;
+	const char* Arguments; // passed to the scene after the headless options
+};
+
+const Scene SCENES[] = {
+	{ 2, "triangle",        "" },
+	{ 3, "raster",          "" },
+	{ 4, "transforms",      "" },
+	{ 5, "projections",     "" },
+	{ 5, "split multiview", " --split" },
+	{ 5, "split passes",    " --split --separate-passes" },
+	{ 6, "lighting",        "" },
+	{ 7, "shadows",         "" },
+	{ 8, "bezier",          "" }
+};
+
+const unsigned int WARMUP_FRAMES = 60;
+const unsigned int MEASURED_FRAMES = 600;
+
+#ifdef _WIN32
+const char* const EXECUTABLE_SUFFIX = ".exe";
+#define popen _popen
+#define pclose _pclose
+#else
+const char* const EXECUTABLE_SUFFIX = "";
+#endif
+
+namespace fs = std::filesystem;
+
+// quotes an argument for the shell
+static std::string quote(const std::string &text) {
+	return "\"" + text + "\"";
+}
+
+// short hash of the checked out commit, empty outside of a git repository
+static std::string commit() {
+	std::string hash;
+	FILE* pipe = popen("git rev-parse --short HEAD", "r");
+	if (pipe == NULL) return hash;
+	char buffer[64];
+	while (fgets(buffer, sizeof(buffer), pipe) != NULL) hash += buffer;
+	pclose(pipe);
+	while (!hash.empty() && (hash.back() == '\n' || hash.back() == '\r')) hash.pop_back();
+	return hash;
+}
+
+// runs one scene, returns its JSON object or one describing the failure
+static std::string run(const Scene &scene, const fs::path &bin, const std::string &options) {
+	std::string name = "HW" + std::to_string(scene.Homework);
+	fs::path executable = fs::absolute(bin / (name + EXECUTABLE_SUFFIX));
+	fs::path directory = fs::path("Homework " + std::to_string(scene.Homework)) / "src";
+	fs::path output = fs::temp_directory_path() / ("bench_" + name + ".json");
+	std::string error;
+	if (!fs::exists(executable)) error = "not built: " + executable.string();
+	else if (!fs::is_directory(directory)) error = "missing " + directory.string() + ", run from the repository root";
+	else {
+		fs::remove(output);
+		std::string command = "cd " + quote(directory.string()) + " && " + quote(executable.string())
+			+ " --headless" + options + scene.Arguments + " --bench " + quote(output.string()) + " 1>&2";
+		// the scene's own output goes to stderr, stdout is kept for the results
+		std::cerr << "running " << name << " (" << scene.Name << ")" << std::endl;
+		int status = std::system(command.c_str());
+		if (status != 0) error = "exit status " + std::to_string(status);
+		else {
+			std::ifstream file(output);
+			std::stringstream result;
+			result << file.rdbuf();
+			std::string json = result.str();
+			while (!json.empty() && (json.back() == '\n' || json.back() == '\r')) json.pop_back();
+			fs::remove(output);
+			// the scene's object with the homework in front
+			if (json.size() > 2 && json.front() == '{')
+				return "{\"homework\":" + std::to_string(scene.Homework) + ",\"name\":\"" + scene.Name + "\"," + json.substr(1);
+			error = "no results written";
+		}
+	}
+	std::cerr << "ERROR::BENCHMARK::" << name << ": " << error << std::endl;
+	std::string escaped;
+	for (char c : error) {
+		if (c == '"' || c == '\\') escaped += '\\';
+		escaped += c;
+	}
+	return "{\"homework\":" + std::to_string(scene.Homework) + ",\"name\":\"" + scene.Name + "\",\"error\":\"" + escaped + "\"}";
+}
+
+int main(int argc, char* argv[]) {
+	fs::path bin = "build";
+	unsigned int warmup = WARMUP_FRAMES, frames = MEASURED_FRAMES;
+	std::string size, outputPath;
+	std::vector<unsigned int> selected;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--bin" && i + 1 < argc) bin = argv[++i];
+		else if (arg == "--warmup" && i + 1 < argc) warmup = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+		else if (arg == "--frames" && i + 1 < argc) frames = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+		else if (arg == "--size" && i + 1 < argc) size = argv[++i];
+		else if (arg == "--output" && i + 1 < argc) outputPath = argv[++i];
+		else if (std::atoi(arg.c_str()) > 0) selected.push_back((unsigned int)std::atoi(arg.c_str()));
+		else {
+			std::cerr << "usage: benchmark [--bin DIR] [--warmup N] [--frames M] [--size WxH] [--output FILE] [homework...]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::string options = " --warmup " + std::to_string(warmup) + " --frames " + std::to_string(frames);
+	if (!size.empty()) options += " --size " + quote(size);
+
+	std::stringstream json;
+	json << "{\"commit\":\"" << commit() << "\",\"warmup\":" << warmup << ",\"frames\":" << frames << ",\"scenes\":[";
+	bool first = true, failed = false;
+	for (const Scene &scene : SCENES) {
+		if (!selected.empty() && std::find(selected.begin(), selected.end(), scene.Homework) == selected.end()) continue;
+		std::string result = run(scene, bin, options);
+		failed |= result.find("\"error\":") != std::string::npos;
+		json << (first ? "\n" : ",\n") << result;
+		first = false;
+	}
+	json << "\n]}\n";
+
+	if (outputPath.empty()) std::cout << json.str();
+	else {
+		std::ofstream output(outputPath);
+		if (!output) {
+			std::cerr << "ERROR::BENCHMARK::FILE_NOT_WRITTEN: " << outputPath << std::endl;
+			return 1;
+		}
+		output << json.str();
+		std::cerr << "wrote " << outputPath << std::endl;
+	}
+	return failed ? 1 : 0;
+}